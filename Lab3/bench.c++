@@ -0,0 +1,317 @@
+// Сравнение счётчика в разделяемой памяти: под именованным семафором и на атомиках.
+// Несколько процессов одновременно выполняют одну и ту же операцию над общим
+// счётчиком, затем итог сверяется с ожидаемым. Затем те же процессы заполняют
+// общую гистограмму в SharedArena, одновременно растя область. В конце один
+// писатель обновляет снимок из нескольких полей, а всё больше процессов его
+// опрашивают — под семафором и через SeqLock. Напоследок — SharedMutex:
+// счётчик под ним, восстановление после смерти владельца и пинг-понг на
+// SharedCondition между двумя процессами.
+// Запуск: bench [число процессов] [операций на процесс]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <semaphore.h>
+#include <unistd.h>
+#endif
+
+#include "mem_shr.hpp"
+#include "sem_mng.hpp"
+#include "shm_arena.hpp"
+#include "seqlock.hpp"
+
+enum class Op { Increment, Update, Get };
+
+static const char* op_name(Op op) {
+    switch (op) {
+        case Op::Increment: return "increment";
+        case Op::Update: return "update";
+        case Op::Get: return "get";
+    }
+    return "?";
+}
+
+template <typename Data>
+static void worker(Data* data, SharedSemaphore& sem, Op op, long ops) {
+    long long sink = 0;
+    for (long i = 0; i < ops; ++i) {
+        switch (op) {
+            case Op::Increment: increment_counter(data, sem); break;
+            case Op::Update: update_counter(data, sem, [](auto value) { return value + 1; }); break;
+            case Op::Get: sink += get_counter(data, sem); break;
+        }
+    }
+    if (sink == -1) std::printf("%lld\n", sink); // не даём компилятору выкинуть чтения
+}
+
+// Запускает workers исполнителей (процессы; в Windows — потоки) и ждёт их
+template <typename Body>
+static double run_workers(int workers, Body body) {
+    auto start = std::chrono::steady_clock::now();
+#ifdef _WIN32
+    std::vector<std::thread> threads;
+    for (int w = 0; w < workers; ++w) threads.emplace_back([&, w] { body(w); });
+    for (auto& t : threads) t.join();
+#else
+    std::vector<pid_t> children;
+    for (int w = 0; w < workers; ++w) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            body(w);
+            _exit(0);
+        }
+        if (pid < 0) {
+            std::perror("fork");
+            break;
+        }
+        children.push_back(pid);
+    }
+    for (pid_t pid : children) waitpid(pid, nullptr, 0);
+#endif
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+template <typename Data>
+static void bench(const char* layout, Data* data, SharedSemaphore& sem, int workers, long ops) {
+    for (Op op : {Op::Increment, Op::Update, Op::Get}) {
+        set_zero_shared_memory(data, sem);
+        double seconds = run_workers(workers, [&](int) { worker(data, sem, op, ops); });
+        double total = static_cast<double>(workers) * static_cast<double>(ops);
+        long long counter = get_counter(data, sem);
+        long long expected = op == Op::Get ? 0 : static_cast<long long>(total);
+        std::printf("%-10s %-10s %9.1f нс/оп %9.2f млн оп/с  счётчик %lld%s\n", layout, op_name(op),
+                    seconds * 1e9 / total, total / seconds / 1e6, counter,
+                    counter == expected ? "" : "  ОШИБКА: потеряны обновления");
+    }
+}
+
+// Гистограмма из 1024 атомарных корзин — именованный блок арены. Каждый процесс
+// открывает арену сам и находит блок по имени; первый попутно выделяет крупные
+// блоки, так что область несколько раз растёт и переотображается во время замера
+static void bench_arena(const char* name, int workers, long ops) {
+    const size_t buckets = 1024;
+    auto body = [&](int index) {
+        SharedArena arena(name, 4096);
+        auto histogram = arena.find_or_allocate_array<std::atomic<uint64_t>>("histogram", buckets);
+        for (long i = 0; i < ops; ++i) {
+            if (index == 0 && i % (ops / 16 + 1) == 0) arena.allocate(64 * 1024);
+            arena.get(histogram, buckets)[static_cast<size_t>(i) % buckets].fetch_add(1, std::memory_order_relaxed);
+        }
+    };
+
+    SharedArena arena(name, 4096);
+    size_t before = arena.capacity();
+    double seconds = run_workers(workers, body);
+    double total = static_cast<double>(workers) * static_cast<double>(ops);
+
+    auto histogram = arena.find_or_allocate_array<std::atomic<uint64_t>>("histogram", buckets);
+    uint64_t sum = 0;
+    std::atomic<uint64_t>* counts = arena.get(histogram, buckets);
+    for (size_t i = 0; i < buckets; ++i) sum += counts[i].load();
+    std::printf("%-10s %-10s %9.1f нс/оп %9.2f млн оп/с  сумма %llu%s, область %zu -> %zu КБ\n", "arena",
+                "histogram", seconds * 1e9 / total, total / seconds / 1e6, static_cast<unsigned long long>(sum),
+                sum == static_cast<uint64_t>(total) ? "" : "  ОШИБКА: потеряны обновления", before / 1024,
+                arena.capacity() / 1024);
+}
+
+// Снимок из нескольких полей; согласован, если b == 2a и c == 3a
+struct Sample {
+    uint64_t a;
+    uint64_t b;
+    uint64_t c;
+    int64_t updated;
+};
+
+struct alignas(64) ReaderStats {
+    std::atomic<uint64_t> reads;
+    std::atomic<uint64_t> torn;
+};
+
+const int MAX_READERS = 64;
+
+struct SnapshotBench {
+    SeqLock<Sample> snapshot;
+    alignas(64) Sample guarded;           // Тот же снимок под семафором
+    alignas(64) std::atomic<int> ready;   // Сколько читателей уже запущено
+    std::atomic<int> stop;
+    ReaderStats readers[MAX_READERS];
+};
+
+// Процесс 0 пишет ops снимков и поднимает stop, остальные читают, пока не stop
+static void bench_snapshot(SharedMemory& memory, SharedSemaphore& sem, bool seqlock, int readers, long ops) {
+    memory.set_zero();
+    auto* shared = static_cast<SnapshotBench*>(memory.raw());
+    double write_seconds = 0;
+    auto body = [&](int index) {
+        if (index == 0) {
+            while (shared->ready.load() < readers) std::this_thread::yield();
+            auto start = std::chrono::steady_clock::now();
+            for (long i = 1; i <= ops; ++i) {
+                Sample sample{static_cast<uint64_t>(i), 2 * static_cast<uint64_t>(i), 3 * static_cast<uint64_t>(i), i};
+                if (seqlock) {
+                    shared->snapshot.store(sample);
+                } else {
+                    sem.wait();
+                    shared->guarded = sample;
+                    sem.signal();
+                }
+            }
+            shared->stop.store(1);
+            write_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            // Время писателя нужно родителю, а в POSIX это отдельный процесс
+            shared->readers[MAX_READERS - 1].reads.store(static_cast<uint64_t>(write_seconds * 1e9));
+            return;
+        }
+        ReaderStats& stats = shared->readers[index - 1];
+        uint64_t reads = 0, torn = 0;
+        shared->ready.fetch_add(1);
+        while (!shared->stop.load(std::memory_order_relaxed)) {
+            Sample sample;
+            if (seqlock) {
+                sample = shared->snapshot.load();
+            } else {
+                sem.wait();
+                sample = shared->guarded;
+                sem.signal();
+            }
+            if (sample.b != 2 * sample.a || sample.c != 3 * sample.a) torn++;
+            reads++;
+        }
+        stats.reads.store(reads);
+        stats.torn.store(torn);
+    };
+
+    double seconds = run_workers(readers + 1, body);
+    write_seconds = static_cast<double>(shared->readers[MAX_READERS - 1].reads.load()) / 1e9;
+    uint64_t reads = 0, torn = 0;
+    for (int r = 0; r < readers; ++r) {
+        reads += shared->readers[r].reads.load();
+        torn += shared->readers[r].torn.load();
+    }
+    std::printf("%-10s %2d чит.  запись %7.1f нс  чтений %9.2f млн/с%s\n", seqlock ? "seqlock" : "semaphore",
+                readers, write_seconds * 1e9 / static_cast<double>(ops), static_cast<double>(reads) / seconds / 1e6,
+                torn ? "  ОШИБКА: несогласованные снимки" : "");
+}
+
+struct MutexBench {
+    SharedMutex mutex;
+    SharedCondition cond;
+    int64_t counter;
+    int64_t turn;       // Пинг-понг: чей ход (0 или 1)
+};
+
+static void bench_mutex(SharedMemory& memory, int workers, long ops) {
+    memory.set_zero();
+    auto* shared = static_cast<MutexBench*>(memory.raw());
+    shared->mutex.init("Local\\lab3_bench_mutex");
+    shared->cond.init("Local\\lab3_bench_cond");
+
+    double seconds = run_workers(workers, [&](int) {
+        for (long i = 0; i < ops; ++i) {
+            shared->mutex.lock();
+            shared->counter++;
+            shared->mutex.unlock();
+        }
+    });
+    double total = static_cast<double>(workers) * static_cast<double>(ops);
+    std::printf("%-10s %-10s %9.1f нс/оп %9.2f млн оп/с  счётчик %lld%s\n", "mutex", "increment",
+                seconds * 1e9 / total, total / seconds / 1e6, static_cast<long long>(shared->counter),
+                shared->counter == static_cast<int64_t>(total) ? "" : "  ОШИБКА: потеряны обновления");
+
+    // Владелец умирает посреди критической секции
+    run_workers(1, [&](int) {
+        shared->mutex.lock();
+        shared->counter = -1;
+#ifdef _WIN32
+        ExitThread(0);
+#else
+        _exit(0);
+#endif
+    });
+    bool recovered = shared->mutex.lock();
+    shared->mutex.unlock();
+    std::printf("%-10s %-10s %s\n", "mutex", "owner dead",
+                recovered ? "следующий lock() получил мьютекс и сообщил о смерти владельца"
+                          : "ОШИБКА: смерть владельца не замечена");
+
+    // Два процесса передают ход друг другу через условную переменную
+    long rounds = ops / 10 + 1;
+    shared->turn = 0;
+    seconds = run_workers(2, [&](int index) {
+        for (long i = 0; i < rounds; ++i) {
+            shared->mutex.lock();
+            while (shared->turn != index) shared->cond.wait(shared->mutex);
+            shared->turn = 1 - index;
+            shared->cond.notify_all();
+            shared->mutex.unlock();
+        }
+    });
+    std::printf("%-10s %-10s %9.1f мкс на передачу хода\n", "condition", "ping-pong",
+                seconds * 1e6 / static_cast<double>(2 * rounds));
+}
+
+int main(int argc, char* argv[]) {
+#ifdef _WIN32
+    SetConsoleOutputCP(CP_UTF8);
+#endif
+    int workers = argc > 1 ? std::atoi(argv[1]) : 4;
+    long ops = argc > 2 ? std::atol(argv[2]) : 200000;
+    if (workers < 1 || ops < 1) {
+        std::fprintf(stderr, "Использование: %s [процессов] [операций на процесс]\n", argv[0]);
+        return 1;
+    }
+    std::printf("%d процесс(ов) по %ld операций\n", workers, ops);
+
+    const char* locked_name = "/lab3_bench_locked";
+    const char* atomic_name = "/lab3_bench_atomic";
+    const char* sem_name = "/lab3_bench_sem";
+    const char* arena_name = "/lab3_bench_arena";
+    const char* snapshot_name = "/lab3_bench_snapshot";
+    const char* mutex_name = "/lab3_bench_mutex";
+#ifndef _WIN32
+    // Семафор, оставшийся занятым от прерванного запуска, повесил бы замер
+    sem_unlink(sem_name);
+    shm_unlink(arena_name);
+#endif
+
+    try {
+        SharedSemaphore sem(sem_name);
+        SharedMemory locked(locked_name, sizeof(SharedMemoryDataLocked));
+        SharedMemory atomic(atomic_name, sizeof(SharedMemoryDataAtomic));
+
+        bench("semaphore", static_cast<SharedMemoryDataLocked*>(locked.raw()), sem, workers, ops);
+        bench("atomic", static_cast<SharedMemoryDataAtomic*>(atomic.raw()), sem, workers, ops);
+        bench_arena(arena_name, workers, ops);
+
+        SharedMemory snapshot(snapshot_name, sizeof(SnapshotBench));
+        for (int readers = 1; readers <= workers && readers < MAX_READERS; readers *= 2) {
+            bench_snapshot(snapshot, sem, false, readers, ops);
+            bench_snapshot(snapshot, sem, true, readers, ops);
+        }
+
+        SharedMemory mutex(mutex_name, sizeof(MutexBench));
+        bench_mutex(mutex, workers, ops);
+    } catch (const std::exception& ex) {
+        std::fprintf(stderr, "Ошибка: %s\n", ex.what());
+        return 1;
+    }
+
+#ifndef _WIN32
+    shm_unlink(locked_name);
+    shm_unlink(atomic_name);
+    sem_unlink(sem_name);
+    shm_unlink(arena_name);
+    shm_unlink(snapshot_name);
+    shm_unlink(mutex_name);
+#endif
+    return 0;
+}
@@ -0,0 +1,83 @@
+// Микробенчмарк и сверка format_timestamp с прежней time_to_str.
+// legacy:: — прежняя реализация (ostringstream + setw), только время берётся
+// из аргумента, а не с часов, чтобы сравнивать результаты на одних и тех же моментах.
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <iomanip>
+#include <random>
+#include <sstream>
+#include <string>
+#include "time_fmt.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+namespace legacy {
+
+std::string time_to_str(int64_t unix_ms) {
+    std::ostringstream oss;
+    std::time_t sec = static_cast<std::time_t>(unix_ms / 1000);
+    std::tm t;
+#ifdef _WIN32
+    localtime_s(&t, &sec);
+#else
+    localtime_r(&sec, &t);
+#endif
+    oss << std::setfill('0')
+        << std::setw(4) << t.tm_year + 1900 << '-'
+        << std::setw(2) << t.tm_mon + 1 << '-'
+        << std::setw(2) << t.tm_mday << ' '
+        << std::setw(2) << t.tm_hour << ':'
+        << std::setw(2) << t.tm_min << ':'
+        << std::setw(2) << t.tm_sec << '.'
+        << std::setw(3) << (unix_ms % 1000);
+    return oss.str();
+}
+
+} // namespace legacy
+
+// Как в логе: время идёт вперёд, за секунду — много строк
+template <typename Format>
+static double measure(long count, int64_t start_ms, Format format) {
+    size_t sink = 0;
+    auto begin = std::chrono::steady_clock::now();
+    for (long i = 0; i < count; ++i) sink += format(start_ms + i / 16);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    if (sink == 1) std::printf("\n");   // не даём компилятору выкинуть вызовы
+    return seconds * 1e9 / static_cast<double>(count);
+}
+
+int main(int argc, char* argv[]) {
+#ifdef _WIN32
+    SetConsoleOutputCP(CP_UTF8);
+#endif
+    long count = argc > 1 ? std::atol(argv[1]) : 2000000;
+
+    // Сверка на случайных моментах 1971-2100 и на границах секунд
+    std::mt19937_64 rng(42);
+    std::uniform_int_distribution<int64_t> moment(31536000000LL, 4102444800000LL);
+    long mismatches = 0;
+    char buf[TIMESTAMP_LENGTH + 1];
+    for (int i = 0; i < 200000; ++i) {
+        int64_t ms = moment(rng);
+        if (i % 4 == 0) ms -= ms % 1000;
+        if (i % 4 == 1) ms = ms - ms % 1000 + 999;
+        format_timestamp(ms, buf);
+        if (legacy::time_to_str(ms) != buf) {
+            if (mismatches++ < 5) std::printf("Расхождение: %s против %s\n", buf, legacy::time_to_str(ms).c_str());
+        }
+    }
+    std::printf("Сверка: %s\n", mismatches ? "ЕСТЬ РАСХОЖДЕНИЯ" : "совпадает на 200000 моментах");
+
+    int64_t now = unix_time_ms();
+    double old_ns = measure(count, now, [](int64_t ms) { return legacy::time_to_str(ms).size(); });
+    double new_ns = measure(count, now, [&](int64_t ms) { return format_timestamp(ms, buf); });
+    double clock_ns = measure(count, now, [&](int64_t) { return format_now(buf); });
+    std::printf("time_to_str (ostringstream): %8.1f нс\n", old_ns);
+    std::printf("format_timestamp:            %8.1f нс  (в %.1f раз быстрее)\n", new_ns, old_ns / new_ns);
+    std::printf("format_now (с чтением часов): %7.1f нс\n", clock_ns);
+    return mismatches ? 1 : 0;
+}
@@ -17,17 +17,19 @@
 #endif
 
 
-SharedMemory::SharedMemory(const std::string& name)
-    : name_(name)
+SharedMemory::SharedMemory(const std::string& name, size_t size, size_t max_size)
+    : name_(name), size_(size)
 {
 #ifdef _WIN32
-    // Создаём/открываем объект отображаемого файла в памяти
+    // Адреса под максимальный размер резервируются сразу (SEC_RESERVE),
+    // а память под них выделяется по мере роста (VirtualAlloc MEM_COMMIT)
+    size_t reserve = max_size > size_ ? max_size : size_;
     hMapFile_ = CreateFileMappingA(
         INVALID_HANDLE_VALUE,                 // Используем анонимную память, не реальный файл
         nullptr,                              // Атрибуты безопасности по умолчанию
-        PAGE_READWRITE,                       // Чтение/запись
-        0,                                    // Старшая часть размера (0, т.к. размер маленький)
-        static_cast<DWORD>(sizeof(SharedMemoryData)), // Размер области
+        PAGE_READWRITE | SEC_RESERVE,         // Чтение/запись, страницы подключаются по мере роста
+        static_cast<DWORD>(static_cast<uint64_t>(reserve) >> 32), // Старшая часть размера
+        static_cast<DWORD>(reserve & 0xFFFFFFFFu),                // Младшая часть размера
         name_.c_str()                         // Имя объекта (одно и то же во всех процессах)
     );
     if (!hMapFile_) {
@@ -35,41 +37,79 @@ SharedMemory::SharedMemory(const std::string& name)
         throw std::runtime_error("CreateFileMapping failed, error: " +
                                  std::to_string(GetLastError()));
     }
-    // Отображаем объект в адресное пространство процесса
+    // Отображаем объект целиком: если его создал другой процесс, размер задал он
     void* p = MapViewOfFile(
         hMapFile_,                // Дескриптор объекта отображения
         FILE_MAP_ALL_ACCESS,      // Права чтения/записи
         0,                        // Смещение по старшей части
         0,                        // Смещение по младшей части
-        sizeof(SharedMemoryData)  // Размер отображения
+        0                         // Весь объект
     );
     if (!p) {
         CloseHandle(hMapFile_);   // Чистим ресурс
         throw std::runtime_error("MapViewOfFile failed, error: " +
                                  std::to_string(GetLastError()));
     }
+    // Размер резерва узнаём у самого отображения: max_size мог задать другой процесс.
+    // VirtualQuery отдаёт по одному участку с одинаковым состоянием страниц (у уже
+    // выросшей области первым идёт подключённый), поэтому суммируем все участки,
+    // пока они принадлежат этому отображению
+    MEMORY_BASIC_INFORMATION info{};
+    while (VirtualQuery(static_cast<char*>(p) + reserved_, &info, sizeof(info)) == sizeof(info) &&
+           info.AllocationBase == p && info.State != MEM_FREE) {
+        reserved_ += info.RegionSize;
+    }
+    if (size_ > reserved_ || !VirtualAlloc(p, size_, MEM_COMMIT, PAGE_READWRITE)) {
+        UnmapViewOfFile(p);
+        CloseHandle(hMapFile_);
+        throw std::runtime_error("VirtualAlloc failed, error: " +
+                                 std::to_string(GetLastError()));
+    }
     // Сохраняем указатель на разделяемую структуру
     data_ = static_cast<SharedMemoryData*>(p);
 #else   // POSIX-вариант
-    // Открываем/создаём объект POSIX shared memory
-    int shm_fd = shm_open(name_.c_str(), O_CREAT | O_RDWR, 0666);
-    if (shm_fd == -1) {
+    // Размер задаёт только создатель объекта (O_EXCL): ftruncate у открывшего
+    // уже существующий объект мог бы урезать его посреди чужого grow
+    fd_ = shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0666);
+    bool creator = fd_ != -1;
+    if (!creator && errno == EEXIST) {
+        fd_ = shm_open(name_.c_str(), O_RDWR, 0666);
+    }
+    if (fd_ == -1) {
         throw std::runtime_error("shm_open failed");
     }
-    // Устанавливаем размер сегмента под нашу структуру
-    if (ftruncate(shm_fd, sizeof(SharedMemoryData)) == -1) {
-        close(shm_fd);
+    if (creator && ftruncate(fd_, static_cast<off_t>(size_)) == -1) {
+        close(fd_);
+        shm_unlink(name_.c_str());
         throw std::runtime_error("ftruncate failed");
     }
+    // Открывший отображает объект в его текущем размере (он мог уже вырасти).
+    // Пустой объект — создатель ещё не успел задать размер: ждём его
+    struct stat st{};
+    for (int attempt = 0; attempt < 1000; ++attempt) {
+        if (fstat(fd_, &st) == -1 || st.st_size > 0) break;
+        usleep(1000);
+    }
+    if (st.st_size <= 0) {
+        close(fd_);
+        throw std::runtime_error("shared memory " + name_ + " was created but never sized");
+    }
+    if (static_cast<size_t>(st.st_size) < size_ && max_size == 0) {
+        // Область без роста (счётчик) другой раскладки — скорее всего, объект от старой сборки
+        close(fd_);
+        throw std::runtime_error("shared memory " + name_ + " has " + std::to_string(st.st_size) +
+                                 " bytes, expected " + std::to_string(size_));
+    }
+    size_ = static_cast<size_t>(st.st_size);
     // Отображаем shared memory в адресное пространство процесса
     void* p = mmap(nullptr,
-                   sizeof(SharedMemoryData),
+                   size_,
                    PROT_READ | PROT_WRITE,   // Чтение/запись
                    MAP_SHARED,               // Общая память между процессами
-                   shm_fd,
+                   fd_,
                    0);
-    close(shm_fd);                            // Дескриптор fd больше не нужен
     if (p == MAP_FAILED) {
+        close(fd_);
         throw std::runtime_error("mmap failed");
     }
     // Сохраняем указатель на разделяемую структуру
@@ -88,9 +128,37 @@ SharedMemory::~SharedMemory() {
     }
 #else
     if (data_) {
-        munmap(data_, sizeof(SharedMemoryData)); // Отсоединяем shared memory
+        munmap(data_, size_);                // Отсоединяем shared memory
+    }
+    if (fd_ != -1) {
+        close(fd_);
     }
-    
+#endif
+}
+
+bool SharedMemory::grow(size_t size) {
+    if (size <= size_) return true;
+#ifdef _WIN32
+    // Резерв адресов не растёт: дальше max_size, заданного при создании, не вырастить
+    if (size > reserved_) return false;
+    if (!VirtualAlloc(data_, size, MEM_COMMIT, PAGE_READWRITE)) return false;
+    size_ = size;
+    return true;
+#else
+    // Увеличиваем объект, только если его ещё не увеличил кто-то другой.
+    // Между fstat и ftruncate объект может вырасти сильнее — поэтому растить
+    // его процессы должны под общей блокировкой (как SharedArena)
+    struct stat st;
+    if (fstat(fd_, &st) == -1) return false;
+    if (static_cast<size_t>(st.st_size) < size && ftruncate(fd_, static_cast<off_t>(size)) == -1) {
+        return false;
+    }
+    void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (p == MAP_FAILED) return false;
+    munmap(data_, size_);
+    data_ = static_cast<SharedMemoryData*>(p);
+    size_ = size;
+    return true;
 #endif
 }
 
@@ -101,5 +169,5 @@ const SharedMemoryData* SharedMemory::get() const { return data_; }
 // Обнулить всю структуру в shared memory (например, при первом запуске)
 void SharedMemory::set_zero() {
     if (!data_) return;
-    std::memset(data_, 0, sizeof(SharedMemoryData));
+    std::memset(static_cast<void*>(data_), 0, size_);
 }
\ No newline at end of file
@@ -1,28 +1,69 @@
 #pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <string>
 
-// Структура, лежащая в shared memory
-struct SharedMemoryData {
+// Структура, лежащая в shared memory: каждое обращение — под именованным семафором
+struct SharedMemoryDataLocked {
     int counter;
     int is_initialized; // Флаг инициализации (0 - не инициализирован, 1 - инициализирован)
 };
 
-// Обёртка над разделяемой памятью
+// То же без семафора: поля — атомики. В разделяемой памяти они работают, только если
+// не используют скрытых блокировок (lock-free атомик не зависит от адреса в процессе)
+struct SharedMemoryDataAtomic {
+    std::atomic<int64_t> counter;
+    std::atomic<int> is_initialized;
+};
+static_assert(std::atomic<int64_t>::is_always_lock_free, "shared counter needs lock-free 64-bit atomics");
+static_assert(std::atomic<int>::is_always_lock_free, "shared flag needs lock-free atomics");
+
+// Раскладку выбирает опция сборки LAB3_ATOMIC_COUNTER (см. CMakeLists.txt).
+// Оба варианта остаются доступны — bench сравнивает их между собой
+#ifdef LAB3_ATOMIC_COUNTER
+using SharedMemoryData = SharedMemoryDataAtomic;
+#else
+using SharedMemoryData = SharedMemoryDataLocked;
+#endif
+
+// Обёртка над разделяемой памятью.
+// Область может расти (grow): в POSIX объект увеличивается ftruncate и
+// отображается заново, в Windows под неё сразу резервируется max_size адресов,
+// а страницы подключаются по мере роста. После grow адрес области в этом
+// процессе может поменяться — поэтому внутри неё хранят смещения, а не указатели
 class SharedMemory {
 public:
-    explicit SharedMemory(const std::string& name);
+    // size — размер нового объекта. Уже существующий отображается в своём
+    // текущем размере и никогда не урезается; если он меньше size, это ошибка
+    // для области без роста, а растущая (max_size > 0) догоняет размер через grow.
+    // max_size — предел роста в Windows, 0 — равен size
+    explicit SharedMemory(const std::string& name, size_t size = sizeof(SharedMemoryData),
+                          size_t max_size = 0);
     SharedMemory(const SharedMemory&) = delete;
     SharedMemory& operator=(const SharedMemory&) = delete;
     ~SharedMemory();
     SharedMemoryData* get();
     const SharedMemoryData* get() const;
+    // Вся область целиком, для другой раскладки
+    void* raw() { return data_; }
+    size_t size() const { return size_; }
     void set_zero();
+    // Доводит отображение до size байт: увеличивает объект, если он меньше
+    // (размер никогда не уменьшается), и отображает его заново. Тот же вызов
+    // подхватывает рост, сделанный другим процессом. false — не удалось
+    bool grow(size_t size);
 
 private:
     std::string name_;
+    size_t size_;
     SharedMemoryData* data_ = nullptr; // Указатель на структуру данных
 #ifdef _WIN32
     void* hMapFile_ = nullptr; // HANDLE
+    size_t reserved_ = 0;      // Зарезервировано адресов под рост
+#else
+    int fd_ = -1;              // Дескриптор shm нужен для роста
 #endif
 };
 
@@ -30,48 +71,93 @@ private:
 #include "sem_mng.hpp"
 
 // Объявления inline-функций
-int get_counter(SharedMemoryData* memory, SharedSemaphore& sem);
-void set_counter(SharedMemoryData* memory, SharedSemaphore& sem, int value);
-void increment_counter(SharedMemoryData* memory, SharedSemaphore& sem);
-void set_zero_shared_memory(SharedMemoryData* memory, SharedSemaphore& sem);
-bool is_initialized(SharedMemoryData* memory, SharedSemaphore& sem);
-void mark_initialized(SharedMemoryData* memory, SharedSemaphore& sem);
-
-inline int get_counter(SharedMemoryData* memory, SharedSemaphore& sem) {
+int get_counter(SharedMemoryDataLocked* memory, SharedSemaphore& sem);
+void set_counter(SharedMemoryDataLocked* memory, SharedSemaphore& sem, int value);
+void increment_counter(SharedMemoryDataLocked* memory, SharedSemaphore& sem);
+void set_zero_shared_memory(SharedMemoryDataLocked* memory, SharedSemaphore& sem);
+bool is_initialized(SharedMemoryDataLocked* memory, SharedSemaphore& sem);
+void mark_initialized(SharedMemoryDataLocked* memory, SharedSemaphore& sem);
+
+inline int get_counter(SharedMemoryDataLocked* memory, SharedSemaphore& sem) {
     sem.wait();                     // Вход в критическую секцию
     int value = memory->counter;    // Читаем значение
     sem.signal();                   // Выход из критической секции
     return value;
 }
 
-inline void set_counter(SharedMemoryData* memory, SharedSemaphore& sem, int value) {
+inline void set_counter(SharedMemoryDataLocked* memory, SharedSemaphore& sem, int value) {
     sem.wait();
     memory->counter = value;        // Записываем новое значение
     sem.signal();
 }
 
-inline void increment_counter(SharedMemoryData* memory, SharedSemaphore& sem) {
+inline void increment_counter(SharedMemoryDataLocked* memory, SharedSemaphore& sem) {
     sem.wait();
     ++memory->counter;              // Инкремент
     sem.signal();
 }
 
-inline void set_zero_shared_memory(SharedMemoryData* memory, SharedSemaphore& sem) {
+inline void set_zero_shared_memory(SharedMemoryDataLocked* memory, SharedSemaphore& sem) {
     sem.wait();
-    std::memset(memory, 0, sizeof(SharedMemoryData)); // Обнуляем всё
+    std::memset(memory, 0, sizeof(SharedMemoryDataLocked)); // Обнуляем всё
     memory->is_initialized = 1;    // Помечаем как инициализированную
     sem.signal();
 }
 
-inline bool is_initialized(SharedMemoryData* memory, SharedSemaphore& sem) {
+inline bool is_initialized(SharedMemoryDataLocked* memory, SharedSemaphore& sem) {
     sem.wait();
     bool initialized = (memory->is_initialized == 1);
     sem.signal();
     return initialized;
 }
 
-inline void mark_initialized(SharedMemoryData* memory, SharedSemaphore& sem) {
+inline void mark_initialized(SharedMemoryDataLocked* memory, SharedSemaphore& sem) {
     sem.wait();
     memory->is_initialized = 1;
     sem.signal();
-}
\ No newline at end of file
+}
+
+// Чтение-изменение-запись: counter = fn(counter) одним действием
+template <typename Fn>
+inline void update_counter(SharedMemoryDataLocked* memory, SharedSemaphore& sem, Fn fn) {
+    sem.wait();
+    memory->counter = static_cast<int>(fn(memory->counter));
+    sem.signal();
+}
+
+// --- Атомарная раскладка: семафор не нужен, параметр оставлен ради одинаковых вызовов ---
+
+inline int64_t get_counter(SharedMemoryDataAtomic* memory, SharedSemaphore&) {
+    return memory->counter.load(std::memory_order_acquire);
+}
+
+inline void set_counter(SharedMemoryDataAtomic* memory, SharedSemaphore&, int64_t value) {
+    memory->counter.store(value, std::memory_order_release);
+}
+
+inline void increment_counter(SharedMemoryDataAtomic* memory, SharedSemaphore&) {
+    memory->counter.fetch_add(1, std::memory_order_acq_rel);
+}
+
+inline void set_zero_shared_memory(SharedMemoryDataAtomic* memory, SharedSemaphore&) {
+    memory->counter.store(0, std::memory_order_relaxed);
+    memory->is_initialized.store(1, std::memory_order_release);
+}
+
+inline bool is_initialized(SharedMemoryDataAtomic* memory, SharedSemaphore&) {
+    return memory->is_initialized.load(std::memory_order_acquire) == 1;
+}
+
+inline void mark_initialized(SharedMemoryDataAtomic* memory, SharedSemaphore&) {
+    memory->is_initialized.store(1, std::memory_order_release);
+}
+
+// CAS-цикл: если между чтением и записью счётчик изменил другой процесс,
+// compare_exchange вернёт свежее значение и fn применится заново
+template <typename Fn>
+inline void update_counter(SharedMemoryDataAtomic* memory, SharedSemaphore&, Fn fn) {
+    int64_t current = memory->counter.load(std::memory_order_relaxed);
+    while (!memory->counter.compare_exchange_weak(current, static_cast<int64_t>(fn(current)),
+                                                  std::memory_order_acq_rel, std::memory_order_relaxed)) {
+    }
+}
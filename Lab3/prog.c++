@@ -46,9 +46,9 @@ void* increment_thread(void* /*arg*/) {
 // Функция для записи времени и значения счётчика в лог
 void log_counter() {
     auto* data = g_shared_memory->get();
-    int counter_val = get_counter(data, *g_sem_counter);
+    long long counter_val = get_counter(data, *g_sem_counter);
     char buf[64];
-    std::snprintf(buf, sizeof(buf), "Counter value: %d", counter_val);
+    std::snprintf(buf, sizeof(buf), "Counter value: %lld", counter_val);
     do_log(buf);
 }
 
@@ -87,33 +87,34 @@ void* input_thread(void* /*arg*/) {
     return nullptr;
 }
 
-// Обработка SIGINT 
+// Флаг завершения: обработчик SIGINT только поднимает его, а выходит главный поток.
+// Из обработчика нельзя звать exit — atexit(log_flush) возьмёт drain_mtx,
+// который может держать прерванный сигналом поток.
+static volatile std::sig_atomic_t g_stop = 0;
+
+// Обработка SIGINT
 void handle_signal(int /*sig*/) {
-    std::printf("Завершение работы...\n");
-    try {
-        // Если мы главный процесс, освобождаем блокировку
-        if (g_is_master) {
+    g_stop = 1;
+}
+
+// Освобождение блокировки главного процесса при выходе
+void release_master() {
 #ifdef _WIN32
-            if (g_hMasterMutex) {
-                ReleaseMutex(g_hMasterMutex);
-                CloseHandle(g_hMasterMutex);
-                g_hMasterMutex = nullptr;
-            }
+    if (g_hMasterMutex) {
+        ReleaseMutex(g_hMasterMutex);
+        CloseHandle(g_hMasterMutex);
+        g_hMasterMutex = nullptr;
+    }
 #else
-            if (g_master_lock_fd != -1) {
-                struct flock lock = {0};
-                lock.l_type = F_UNLCK;
-                lock.l_whence = SEEK_SET;
-                fcntl(g_master_lock_fd, F_SETLK, &lock);
-                close(g_master_lock_fd);
-                g_master_lock_fd = -1;
-            }
-#endif
-        }
-    } catch (...) {
-        // Игнор ошибок при завершении
+    if (g_master_lock_fd != -1) {
+        struct flock lock = {0};
+        lock.l_type = F_UNLCK;
+        lock.l_whence = SEEK_SET;
+        fcntl(g_master_lock_fd, F_SETLK, &lock);
+        close(g_master_lock_fd);
+        g_master_lock_fd = -1;
     }
-    std::exit(0);
+#endif
 }
 
 // Создание копии программы с параметром (--copy1 или --copy2)
@@ -159,7 +160,9 @@ int create_copy(const char* param) {
                          nullptr };
         execv(g_program_path.c_str(), args);
         std::perror("execv");
-        std::exit(1);
+        // _exit, а не exit: обработчики atexit (log_flush) достались от родителя
+        // вместе с его очередями логов и заблокированными мьютексами
+        _exit(127);
     } else if (pid < 0) {
         std::printf("Не удалось создать дочерний процесс\n");
         return -1;
@@ -242,9 +245,7 @@ void handle_copy_2() {
     do_log("(Copy2) Started");
 
     // *2
-    g_sem_counter->wait();
-    data->counter *= 2;
-    g_sem_counter->signal();
+    update_counter(data, *g_sem_counter, [](auto value) { return value * 2; });
 
 #ifdef _WIN32
     Sleep(2000);
@@ -252,15 +253,8 @@ void handle_copy_2() {
     usleep(2000 * 1000);
 #endif
 
-    // /2
-    g_sem_counter->wait();
-    if (data->counter % 2 == 0) {
-        data->counter /= 2;
-    } else {
-        // Если нечётное, сохраняем в целых числах
-        data->counter = data->counter / 2;
-    }
-    g_sem_counter->signal();
+    // /2 (нечётное делится нацело)
+    update_counter(data, *g_sem_counter, [](auto value) { return value / 2; });
 
     do_log("(Copy2) Exit");
     std::exit(0);
@@ -408,14 +402,20 @@ int main(int argc, char* argv[]) {
             }
         }
 
-        // Ждём потоки
-        thread_join(inc_thread);
-        thread_join(inp_thread);
-        
+        // Рабочие потоки бесконечны: ждём Ctrl+C и завершаемся из главного потока
+        while (!g_stop) {
+#ifdef _WIN32
+            Sleep(100);
+#else
+            usleep(100 * 1000);
+#endif
+        }
+        std::printf("Завершение работы...\n");
         if (g_is_master) {
-            thread_join(logger_thread);
-            thread_join(cop_thread);
+            release_master();
         }
+        // exit, а не return: shm и семафор ещё нужны потокам, их деструкторы звать нельзя
+        std::exit(0);
     } catch (const std::exception& ex) {
         std::fprintf(stderr, "Ошибка: %s\n", ex.what());
         return 1;
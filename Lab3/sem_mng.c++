@@ -1,11 +1,16 @@
 #include "sem_mng.hpp"
 #include <string>
 #include <stdexcept>
+#include <cstring>
 #ifdef _WIN32
 #include <windows.h>
+#include <mutex>
+#include <unordered_map>
 #else
 #include <semaphore.h>
 #include <fcntl.h>
+#include <errno.h>
+#include <time.h>
 #endif
 
 SharedSemaphore::SharedSemaphore(const std::string& name)
@@ -78,4 +83,184 @@ bool SharedSemaphore::try_wait() {
 #else
     return (sem_trywait(sem_) == 0);
 #endif
-}
\ No newline at end of file
+}
+
+#ifdef _WIN32
+// Дескрипторы именованных объектов: в разделяемой памяти лежит только имя,
+// а открывает его каждый процесс один раз
+static HANDLE open_named(const char* name, bool semaphore) {
+    static std::mutex mtx;
+    static std::unordered_map<std::string, HANDLE> handles;
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = handles.find(name);
+    if (it != handles.end()) return it->second;
+    HANDLE h = semaphore ? CreateSemaphoreA(nullptr, 0, LONG_MAX, name) : CreateMutexA(nullptr, FALSE, name);
+    if (!h) {
+        throw std::runtime_error(std::string("cannot open ") + name + ", error: " + std::to_string(GetLastError()));
+    }
+    handles.emplace(name, h);
+    return h;
+}
+
+static void copy_name(char* dst, size_t size, const std::string& name) {
+    std::strncpy(dst, name.c_str(), size - 1);
+    dst[size - 1] = '\0';
+}
+
+void SharedMutex::init(const std::string& name) {
+    copy_name(name_, sizeof(name_), name);
+}
+
+void* SharedMutex::handle() {
+    return open_named(name_, false);
+}
+
+bool SharedMutex::lock() {
+    DWORD res = WaitForSingleObject(handle(), INFINITE);
+    if (res == WAIT_ABANDONED) return true;
+    if (res != WAIT_OBJECT_0) {
+        throw std::runtime_error("WaitForSingleObject failed, error: " + std::to_string(GetLastError()));
+    }
+    return false;
+}
+
+bool SharedMutex::try_lock() {
+    DWORD res = WaitForSingleObject(handle(), 0);
+    return res == WAIT_OBJECT_0 || res == WAIT_ABANDONED;
+}
+
+void SharedMutex::unlock() {
+    ReleaseMutex(handle());
+}
+
+void SharedCondition::init(const std::string& name) {
+    copy_name(name_, sizeof(name_), name);
+    waiters_.store(0);
+}
+
+void* SharedCondition::handle() {
+    return open_named(name_, true);
+}
+
+bool SharedCondition::wait(SharedMutex& mutex) {
+    bool timed_out = false;
+    return wait_for(mutex, -1, timed_out);
+}
+
+bool SharedCondition::wait_for(SharedMutex& mutex, int timeout_ms, bool& timed_out) {
+    // Ждущий отмечается до того, как отпустить мьютекс: notify после этого его не пропустит
+    waiters_.fetch_add(1);
+    mutex.unlock();
+    DWORD res = WaitForSingleObject(handle(), timeout_ms < 0 ? INFINITE : static_cast<DWORD>(timeout_ms));
+    timed_out = res == WAIT_TIMEOUT;
+    if (timed_out) {
+        // Снимаем свою отметку; если её уже забрал notify, забираем и его сигнал
+        long current = waiters_.load();
+        while (current > 0 && !waiters_.compare_exchange_weak(current, current - 1)) {
+        }
+        if (current <= 0) WaitForSingleObject(handle(), INFINITE);
+    }
+    return mutex.lock();
+}
+
+void SharedCondition::notify_one() {
+    long current = waiters_.load();
+    while (current > 0) {
+        if (waiters_.compare_exchange_weak(current, current - 1)) {
+            ReleaseSemaphore(handle(), 1, nullptr);
+            return;
+        }
+    }
+}
+
+void SharedCondition::notify_all() {
+    long count = waiters_.exchange(0);
+    if (count > 0) ReleaseSemaphore(handle(), count, nullptr);
+}
+
+#else
+
+void SharedMutex::init(const std::string& /*name*/) {
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+#ifndef __APPLE__
+    pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+#endif
+    int rc = pthread_mutex_init(&mutex_, &attr);
+    pthread_mutexattr_destroy(&attr);
+    if (rc != 0) {
+        throw std::runtime_error("pthread_mutex_init failed: " + std::string(std::strerror(rc)));
+    }
+}
+
+// Результат захвата: EOWNERDEAD — мьютекс наш, но владелец умер в критической секции.
+// Помечаем мьютекс пригодным (иначе после unlock он станет неисправимым)
+static bool check_lock_result(pthread_mutex_t* mutex, int rc, const char* what) {
+#ifndef __APPLE__
+    if (rc == EOWNERDEAD) {
+        pthread_mutex_consistent(mutex);
+        return true;
+    }
+#else
+    (void)mutex;
+#endif
+    if (rc != 0) {
+        throw std::runtime_error(std::string(what) + " failed: " + std::strerror(rc));
+    }
+    return false;
+}
+
+bool SharedMutex::lock() {
+    return check_lock_result(&mutex_, pthread_mutex_lock(&mutex_), "pthread_mutex_lock");
+}
+
+bool SharedMutex::try_lock() {
+    int rc = pthread_mutex_trylock(&mutex_);
+    if (rc == EBUSY) return false;
+    check_lock_result(&mutex_, rc, "pthread_mutex_trylock");
+    return true;
+}
+
+void SharedMutex::unlock() {
+    pthread_mutex_unlock(&mutex_);
+}
+
+void SharedCondition::init(const std::string& /*name*/) {
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    int rc = pthread_cond_init(&cond_, &attr);
+    pthread_condattr_destroy(&attr);
+    if (rc != 0) {
+        throw std::runtime_error("pthread_cond_init failed: " + std::string(std::strerror(rc)));
+    }
+}
+
+bool SharedCondition::wait(SharedMutex& mutex) {
+    return check_lock_result(&mutex.mutex_, pthread_cond_wait(&cond_, &mutex.mutex_), "pthread_cond_wait");
+}
+
+bool SharedCondition::wait_for(SharedMutex& mutex, int timeout_ms, bool& timed_out) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += static_cast<long>(timeout_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    int rc = pthread_cond_timedwait(&cond_, &mutex.mutex_, &deadline);
+    timed_out = rc == ETIMEDOUT;
+    return check_lock_result(&mutex.mutex_, timed_out ? 0 : rc, "pthread_cond_timedwait");
+}
+
+void SharedCondition::notify_one() {
+    pthread_cond_signal(&cond_);
+}
+
+void SharedCondition::notify_all() {
+    pthread_cond_broadcast(&cond_);
+}
+
+#endif
@@ -1,8 +1,10 @@
 #pragma once
+#include <atomic>
 #include <string>
 #ifdef _WIN32
 #include <windows.h>
 #else
+#include <pthread.h>
 #include <semaphore.h>
 #endif
 
@@ -22,4 +24,68 @@ private:
 #else
     sem_t* sem_ = nullptr;
 #endif
-};
\ No newline at end of file
+};
+
+class SharedCondition;
+
+// Мьютекс, который лежит прямо в разделяемой памяти (в отличие от семафора,
+// у которого в памяти процесса только дескриптор). Создавший область процесс
+// один раз вызывает init(), остальные просто пользуются объектом.
+//
+// POSIX: pthread-мьютекс PTHREAD_PROCESS_SHARED + ROBUST — без конкуренции
+// захват и освобождение обходятся атомарной операцией без системного вызова,
+// ждущие спят на futex. Если владелец умер, держа мьютекс (Copy2 убит между
+// wait и signal), следующий lock() получает его и возвращает true: данные под
+// мьютексом могли остаться недописанными, их надо проверить.
+// Windows: именованный мьютекс (WAIT_ABANDONED — то же, что смерть владельца);
+// в памяти лежит только имя, дескриптор каждый процесс открывает сам
+class SharedMutex {
+public:
+    SharedMutex() = delete;
+    SharedMutex(const SharedMutex&) = delete;
+    SharedMutex& operator=(const SharedMutex&) = delete;
+
+    // name нужен только Windows — имя объекта ядра
+    void init(const std::string& name);
+    // true — предыдущий владелец умер, не освободив мьютекс
+    bool lock();
+    bool try_lock();
+    void unlock();
+
+private:
+    friend class SharedCondition;
+#ifdef _WIN32
+    void* handle();
+    char name_[64];
+#else
+    pthread_mutex_t mutex_;
+#endif
+};
+
+// Условная переменная в разделяемой памяти к SharedMutex.
+// POSIX: pthread_cond_t PTHREAD_PROCESS_SHARED (ожидание на futex).
+// Windows: именованный семафор и счётчик ждущих
+class SharedCondition {
+public:
+    SharedCondition() = delete;
+    SharedCondition(const SharedCondition&) = delete;
+    SharedCondition& operator=(const SharedCondition&) = delete;
+
+    void init(const std::string& name);
+    // Отпускает mutex и ждёт notify; возвращает true, если при повторном захвате
+    // оказалось, что владелец мьютекса умер (как SharedMutex::lock)
+    bool wait(SharedMutex& mutex);
+    // То же с ограничением по времени; timed_out — вышло ли время
+    bool wait_for(SharedMutex& mutex, int timeout_ms, bool& timed_out);
+    void notify_one();
+    void notify_all();
+
+private:
+#ifdef _WIN32
+    void* handle();
+    char name_[64];
+    std::atomic<long> waiters_;
+#else
+    pthread_cond_t cond_;
+#endif
+};
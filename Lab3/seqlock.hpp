@@ -0,0 +1,94 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <type_traits>
+
+// Снимок структуры из нескольких полей под seqlock, для разделяемой памяти.
+// Читатель ничего не записывает в общие строки кэша: он читает счётчик версий,
+// копирует данные и перечитывает счётчик; если между этим шла запись (счётчик
+// нечётный или изменился) — копирует заново. Поэтому частые опросы монитором
+// не замедляют писателей, а читатель повторяет чтение только при встречной записи.
+// Писатели упорядочиваются между собой через тот же счётчик (CAS чётное -> нечётное).
+//
+// Область из нулей — готовый пустой SeqLock (снимок из нулей), так что его можно
+// класть прямо в только что созданную shared memory. T копируется побайтно.
+// Если писатель умрёт посреди записи, счётчик останется нечётным и читатели
+// будут ждать — писать стоит короткими участками без вызовов, которые могут упасть
+template <typename T>
+class SeqLock {
+    static_assert(std::is_trivially_copyable<T>::value, "SeqLock stores T by bytes");
+
+public:
+    // Согласованный снимок
+    T load() const {
+        T value;
+        while (!try_load(value)) std::this_thread::yield();
+        return value;
+    }
+
+    // Одна попытка: false — попали на запись
+    bool try_load(T& out) const {
+        uint64_t before = sequence_.load(std::memory_order_acquire);
+        if (before & 1) return false;
+        uint64_t copy[WORDS];
+        for (size_t i = 0; i < WORDS; ++i) copy[i] = words_[i].load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence_.load(std::memory_order_relaxed) != before) return false;
+        std::memcpy(&out, copy, sizeof(T));
+        return true;
+    }
+
+    void store(const T& value) {
+        uint64_t seq = begin_write();
+        write_words(value);
+        sequence_.store(seq + 2, std::memory_order_release);
+    }
+
+    // Чтение-изменение-запись: fn(T&) меняет текущее значение, другие писатели ждут
+    template <typename Fn>
+    void update(Fn fn) {
+        uint64_t seq = begin_write();
+        uint64_t copy[WORDS];
+        for (size_t i = 0; i < WORDS; ++i) copy[i] = words_[i].load(std::memory_order_relaxed);
+        T value;
+        std::memcpy(&value, copy, sizeof(T));
+        fn(value);
+        write_words(value);
+        sequence_.store(seq + 2, std::memory_order_release);
+    }
+
+    // Сколько записей было (для мониторинга: изменилось ли что-нибудь)
+    uint64_t version() const { return sequence_.load(std::memory_order_acquire) / 2; }
+
+private:
+    static const size_t WORDS = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    // Захватывает право записи: переводит счётчик из чётного в нечётный
+    uint64_t begin_write() {
+        uint64_t seq = sequence_.load(std::memory_order_relaxed);
+        while (true) {
+            if (seq & 1) {
+                std::this_thread::yield();
+                seq = sequence_.load(std::memory_order_relaxed);
+            } else if (sequence_.compare_exchange_weak(seq, seq + 1, std::memory_order_acquire,
+                                                       std::memory_order_relaxed)) {
+                break;
+            }
+        }
+        // Данные не должны стать видны раньше нечётного счётчика
+        std::atomic_thread_fence(std::memory_order_release);
+        return seq;
+    }
+
+    void write_words(const T& value) {
+        uint64_t copy[WORDS] = {};
+        std::memcpy(copy, &value, sizeof(T));
+        for (size_t i = 0; i < WORDS; ++i) words_[i].store(copy[i], std::memory_order_relaxed);
+    }
+
+    alignas(64) std::atomic<uint64_t> sequence_;
+    std::atomic<uint64_t> words_[WORDS];
+};
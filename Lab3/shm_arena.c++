@@ -0,0 +1,207 @@
+#include <cstring>      // std::memset, std::strncmp для каталога имён
+#include <stdexcept>    // std::runtime_error для ошибок
+#include <thread>       // std::this_thread::yield в спин-блокировке
+#include "shm_arena.hpp"
+
+namespace {
+
+const uint32_t ARENA_MAGIC = 0x414E5241;   // "ARNA"
+const size_t SMALL_CLASSES = 9;            // 16 << 0 ... 16 << 8 = 4096
+const size_t LARGE_UNIT = 4096;
+const size_t NAMED_BLOCKS = 32;
+const size_t NAME_LENGTH = 32;
+
+// Перед каждым блоком — 16 байт: вместимость блока и ссылка на следующий
+// свободный (пока блок свободен). Так данные блока выровнены на 16
+struct BlockHeader {
+    uint64_t size;
+    uint64_t next;
+};
+
+struct NamedBlock {
+    char name[NAME_LENGTH];
+    uint64_t offset;
+};
+
+// Состояние заголовка: область только что создана (нули), её размечают, готова
+enum : uint32_t { ARENA_EMPTY = 0, ARENA_INITIALIZING = 1, ARENA_READY = 2 };
+
+size_t round_up(size_t value, size_t unit) {
+    return (value + unit - 1) / unit * unit;
+}
+
+// Номер класса для мелкого блока или SMALL_CLASSES для крупного
+size_t size_class(size_t size) {
+    size_t cls = 0;
+    while (cls < SMALL_CLASSES && (size_t{16} << cls) < size) ++cls;
+    return cls;
+}
+
+} // namespace
+
+struct SharedArena::Header {
+    std::atomic<uint32_t> state;
+    uint32_t magic;
+    std::atomic<int> lock;
+    std::atomic<uint64_t> capacity;        // Размер области; читается без блокировки
+    uint64_t top;                          // Начало ещё не выделенного места
+    uint64_t free_small[SMALL_CLASSES];    // Списки свободных мелких блоков
+    uint64_t free_large;                   // Список свободных крупных блоков
+    NamedBlock names[NAMED_BLOCKS];
+};
+
+SharedArena::SharedArena(const std::string& name, size_t initial_size, size_t max_size)
+    : memory_(name, round_up(initial_size > sizeof(Header) ? initial_size : sizeof(Header) + 1, LARGE_UNIT),
+              max_size)
+{
+    // Размечает область первый открывший её процесс, остальные ждут готовности
+    Header* h = header();
+    uint32_t expected = ARENA_EMPTY;
+    if (h->state.compare_exchange_strong(expected, ARENA_INITIALIZING)) {
+        h->magic = ARENA_MAGIC;
+        h->lock.store(0);
+        h->capacity.store(memory_.size());
+        h->top = round_up(sizeof(Header), 16);
+        h->state.store(ARENA_READY, std::memory_order_release);
+    } else {
+        while (h->state.load(std::memory_order_acquire) != ARENA_READY) std::this_thread::yield();
+    }
+    if (h->magic != ARENA_MAGIC) {
+        throw std::runtime_error("shared memory " + name + " is not an arena");
+    }
+    if (!follow_growth()) {
+        throw std::runtime_error("cannot map shared arena " + name);
+    }
+}
+
+SharedArena::Header* SharedArena::header() {
+    return static_cast<Header*>(memory_.raw());
+}
+
+void SharedArena::lock() {
+    while (header()->lock.exchange(1, std::memory_order_acquire) != 0) {
+        while (header()->lock.load(std::memory_order_relaxed) != 0) std::this_thread::yield();
+    }
+}
+
+void SharedArena::unlock() {
+    header()->lock.store(0, std::memory_order_release);
+}
+
+bool SharedArena::follow_growth() {
+    return memory_.grow(header()->capacity.load(std::memory_order_acquire));
+}
+
+uint64_t SharedArena::allocate_locked(size_t size) {
+    // Свободные блоки могли появиться за пределами нашего отображения
+    if (!follow_growth()) return 0;
+    Header* h = header();
+    char* base = static_cast<char*>(memory_.raw());
+
+    size_t cls = size_class(size ? size : 1);
+    size_t payload = cls < SMALL_CLASSES ? size_t{16} << cls : round_up(size, LARGE_UNIT);
+
+    if (cls < SMALL_CLASSES && h->free_small[cls]) {
+        uint64_t offset = h->free_small[cls];
+        h->free_small[cls] = reinterpret_cast<BlockHeader*>(base + offset - sizeof(BlockHeader))->next;
+        return offset;
+    }
+    if (cls == SMALL_CLASSES) {
+        uint64_t* link = &h->free_large;
+        while (*link) {
+            auto* block = reinterpret_cast<BlockHeader*>(base + *link - sizeof(BlockHeader));
+            if (block->size >= payload) {
+                uint64_t offset = *link;
+                *link = block->next;
+                return offset;
+            }
+            link = &block->next;
+        }
+    }
+
+    size_t need = sizeof(BlockHeader) + payload;
+    if (h->top + need > h->capacity.load()) {
+        size_t capacity = h->capacity.load();
+        size_t grown = round_up(capacity * 2 > h->top + need ? capacity * 2 : h->top + need, LARGE_UNIT);
+        if (!memory_.grow(grown)) return 0;
+        h = header();
+        base = static_cast<char*>(memory_.raw());
+        h->capacity.store(grown, std::memory_order_release);
+    }
+    auto* block = reinterpret_cast<BlockHeader*>(base + h->top);
+    block->size = payload;
+    block->next = 0;
+    uint64_t offset = h->top + sizeof(BlockHeader);
+    h->top += need;
+    return offset;
+}
+
+uint64_t SharedArena::allocate(size_t size) {
+    lock();
+    uint64_t offset = allocate_locked(size);
+    if (offset) {
+        char* block = static_cast<char*>(memory_.raw()) + offset;
+        std::memset(block, 0, reinterpret_cast<BlockHeader*>(block - sizeof(BlockHeader))->size);
+    }
+    unlock();
+    return offset;
+}
+
+void SharedArena::deallocate(uint64_t offset) {
+    if (!offset) return;
+    lock();
+    if (follow_growth()) {
+        Header* h = header();
+        auto* block = reinterpret_cast<BlockHeader*>(static_cast<char*>(memory_.raw()) + offset - sizeof(BlockHeader));
+        size_t cls = size_class(block->size);
+        uint64_t& list = cls < SMALL_CLASSES ? h->free_small[cls] : h->free_large;
+        block->next = list;
+        list = offset;
+    }
+    unlock();
+}
+
+uint64_t SharedArena::find_or_allocate(const std::string& name, size_t size) {
+    if (name.empty() || name.size() >= NAME_LENGTH) return 0;
+    lock();
+    Header* h = header();
+    uint64_t offset = 0;
+    NamedBlock* slot = nullptr;
+    for (NamedBlock& entry : h->names) {
+        if (entry.offset && std::strncmp(entry.name, name.c_str(), NAME_LENGTH) == 0) {
+            offset = entry.offset;
+            break;
+        }
+        if (!entry.offset && !slot) slot = &entry;
+    }
+    if (!offset && slot) {
+        // allocate_locked может переотобразить область — запоминаем номер, а не адрес
+        size_t index = static_cast<size_t>(slot - h->names);
+        offset = allocate_locked(size);
+        if (offset) {
+            char* block = static_cast<char*>(memory_.raw()) + offset;
+            std::memset(block, 0, reinterpret_cast<BlockHeader*>(block - sizeof(BlockHeader))->size);
+            NamedBlock& entry = header()->names[index];
+            std::strncpy(entry.name, name.c_str(), NAME_LENGTH - 1);
+            entry.offset = offset;
+        }
+    }
+    unlock();
+    return offset;
+}
+
+void* SharedArena::at(uint64_t offset, size_t size) {
+    if (offset + size > memory_.size() && !follow_growth()) return nullptr;
+    return static_cast<char*>(memory_.raw()) + offset;
+}
+
+size_t SharedArena::capacity() {
+    return header()->capacity.load(std::memory_order_acquire);
+}
+
+size_t SharedArena::used() {
+    lock();
+    size_t top = header()->top;
+    unlock();
+    return top;
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "mem_shr.hpp"
+
+// Ссылка на объект в арене: смещение от начала области, а не адрес.
+// Область в каждом процессе отображена по своему адресу (и после роста может
+// переехать), а смещение одинаково везде. 0 — пустая ссылка (там заголовок арены)
+template <typename T>
+struct ShmOffset {
+    uint64_t offset = 0;
+    explicit operator bool() const { return offset != 0; }
+};
+
+// Распределитель памяти внутри растущей разделяемой области.
+// Мелкие блоки (до 4 КБ) — по классам размеров 16, 32, ... 4096 со своими
+// списками свободных блоков (slab), крупные — кратные 4 КБ, освобождённые
+// переиспользуются первым подходящим. Новое место берётся с конца области,
+// а когда оно кончается, область растёт вдвое (SharedMemory::grow).
+// Именованные блоки (find_or_allocate) — способ найти в другом процессе
+// структуру, созданную первым: гистограмму, буфер отсчётов, таблицу.
+//
+// Выделение и освобождение идут под спин-блокировкой в заголовке арены;
+// сами данные блоков арена не защищает. Указатель из get() действует, пока
+// этот процесс не вызвал allocate/get, из-за которых область переотобразилась
+class SharedArena {
+public:
+    // max_size — предел роста (нужен Windows для резерва адресов)
+    explicit SharedArena(const std::string& name, size_t initial_size = 64 * 1024,
+                         size_t max_size = 64 * 1024 * 1024);
+    SharedArena(const SharedArena&) = delete;
+    SharedArena& operator=(const SharedArena&) = delete;
+
+    // Выделяет обнулённый блок не меньше size байт, выровненный на 16.
+    // 0 — места нет и область не выросла
+    uint64_t allocate(size_t size);
+    void deallocate(uint64_t offset);
+
+    // Блок с именем (до 31 символа): тот же во всех процессах. Если его ещё
+    // нет — выделяется обнулённым. 0 — не удалось или каталог имён заполнен
+    uint64_t find_or_allocate(const std::string& name, size_t size);
+
+    template <typename T>
+    ShmOffset<T> allocate_array(size_t count) {
+        return ShmOffset<T>{allocate(count * sizeof(T))};
+    }
+
+    template <typename T>
+    ShmOffset<T> find_or_allocate_array(const std::string& name, size_t count) {
+        return ShmOffset<T>{find_or_allocate(name, count * sizeof(T))};
+    }
+
+    // Адрес size байт по смещению в этом процессе; при необходимости
+    // подхватывает рост области, сделанный другим процессом
+    void* at(uint64_t offset, size_t size);
+
+    template <typename T>
+    T* get(ShmOffset<T> ref, size_t count = 1) {
+        return ref ? static_cast<T*>(at(ref.offset, count * sizeof(T))) : nullptr;
+    }
+
+    size_t capacity();   // Текущий размер области
+    size_t used();       // Занято блоками (вместе с освобождёнными)
+
+private:
+    struct Header;
+
+    Header* header();
+    void lock();
+    void unlock();
+    bool follow_growth();   // Догоняет размер области, заданный другим процессом
+    uint64_t allocate_locked(size_t size);
+
+    SharedMemory memory_;
+};
@@ -0,0 +1,88 @@
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include "time_fmt.hpp"
+
+namespace {
+
+// "00" "01" ... "99" подряд: две цифры числа n лежат по адресу 2 * n
+struct DigitPairs {
+    char text[200];
+    DigitPairs() {
+        for (int i = 0; i < 100; ++i) {
+            text[2 * i] = static_cast<char>('0' + i / 10);
+            text[2 * i + 1] = static_cast<char>('0' + i % 10);
+        }
+    }
+};
+
+const DigitPairs DIGITS;
+
+inline char* put2(char* out, int value) {
+    std::memcpy(out, DIGITS.text + 2 * value, 2);
+    return out + 2;
+}
+
+// Префикс до секунд для последней секунды, которую форматировал этот поток
+struct SecondCache {
+    int64_t second = INT64_MIN;
+    char prefix[19];
+};
+
+thread_local SecondCache t_cache;
+
+void fill_prefix(int64_t second, char* out) {
+    std::time_t t = static_cast<std::time_t>(second);
+    std::tm tm;
+#ifdef _WIN32
+    localtime_s(&tm, &t);
+#else
+    localtime_r(&t, &tm);
+#endif
+    int year = tm.tm_year + 1900;
+    if (year < 0 || year > 9999) year = year < 0 ? 0 : 9999;   // В формат влезают 4 цифры
+    out = put2(out, year / 100);
+    out = put2(out, year % 100);
+    *out++ = '-';
+    out = put2(out, tm.tm_mon + 1);
+    *out++ = '-';
+    out = put2(out, tm.tm_mday);
+    *out++ = ' ';
+    out = put2(out, tm.tm_hour);
+    *out++ = ':';
+    out = put2(out, tm.tm_min);
+    *out++ = ':';
+    put2(out, tm.tm_sec);
+}
+
+} // namespace
+
+size_t format_timestamp(int64_t unix_ms, char* out) {
+    // Деление с округлением вниз, чтобы и до 1970 года миллисекунды были 0..999
+    int64_t second = unix_ms / 1000;
+    int ms = static_cast<int>(unix_ms % 1000);
+    if (ms < 0) {
+        ms += 1000;
+        second--;
+    }
+    SecondCache& cache = t_cache;
+    if (cache.second != second) {
+        fill_prefix(second, cache.prefix);
+        cache.second = second;
+    }
+    std::memcpy(out, cache.prefix, sizeof(cache.prefix));
+    out[19] = '.';
+    out[20] = static_cast<char>('0' + ms / 100);
+    put2(out + 21, ms % 100);
+    out[TIMESTAMP_LENGTH] = '\0';
+    return TIMESTAMP_LENGTH;
+}
+
+int64_t unix_time_ms() {
+    using namespace std::chrono;
+    return duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+}
+
+size_t format_now(char* out) {
+    return format_timestamp(unix_time_ms(), out);
+}
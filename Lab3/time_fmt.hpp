@@ -0,0 +1,17 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Длина "YYYY-MM-DD HH:MM:SS.mmm" без завершающего нуля
+const size_t TIMESTAMP_LENGTH = 23;
+
+// Быстрое форматирование местного времени для логов. Префикс до секунд
+// "YYYY-MM-DD HH:MM:SS" считается через localtime один раз в секунду и
+// хранится в кэше потока; миллисекунды дописываются по таблице двузначных чисел.
+// Пишут в буфер вызывающего не меньше TIMESTAMP_LENGTH + 1 байт, ставят '\0'
+// и возвращают TIMESTAMP_LENGTH
+size_t format_timestamp(int64_t unix_ms, char* out);
+size_t format_now(char* out);
+
+// Текущее время в миллисекундах от эпохи
+int64_t unix_time_ms();
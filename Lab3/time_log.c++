@@ -1,45 +1,151 @@
 #include <iostream>
-#include <fstream>
 #include <string>
-#include <sstream>
-#include <iomanip>
-#include <ctime>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <vector>
+#include <fcntl.h>
 #ifdef _WIN32
 #include <windows.h>
+#include <io.h>
+#define log_open(path) _open(path, _O_WRONLY | _O_APPEND | _O_CREAT | _O_BINARY, 0644)
+#define log_write(fd, data, size) _write(fd, data, static_cast<unsigned>(size))
 #else
 #include <unistd.h>
-#include <sys/time.h>
+#include <signal.h>
+#define log_open(path) open(path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644)
+#define log_write write
 #endif
 #include "time_log.hpp"
+#include "time_fmt.hpp"
+#include "thr.hpp"
+#include "spsc_ring.hpp"
 
 std::string time_to_str() {
-    std::ostringstream oss;
+    char buf[TIMESTAMP_LENGTH + 1];
+    return std::string(buf, format_now(buf));
+}
+
+// --- Асинхронная запись в lab3.log ---
+//
+// У каждого потока своя очередь строк без блокировок (один писатель — этот
+// поток, один читатель — сбрасывающий поток). do_log только форматирует строку
+// в слот очереди; фоновый поток раз в LOG_FLUSH_MS забирает всё из всех очередей
+// и пишет целыми строками одним write в дескриптор, открытый с O_APPEND один раз
+// на процесс. O_APPEND делает каждый write атомарным дописыванием в конец, так
+// что строки разных процессов не перемешиваются внутри строки.
+// Если очередь потока полна или строка не влезает в слот, строка пишется сразу
+// своим write — тоже целиком
+
+namespace {
+
+const size_t LOG_SLOT_SIZE = 508;
+const size_t LOG_QUEUE_SLOTS = 128;
+const size_t LOG_BATCH_SIZE = 64 * 1024;
+const int LOG_FLUSH_MS = 50;
+
+struct LogSlot {
+    uint32_t length;
+    char text[LOG_SLOT_SIZE];
+};
+
+using LogQueue = SpscRing<LogSlot, LOG_QUEUE_SLOTS>;
+
+// Состояние логгера не разрушается: сбрасывающий поток работает до конца
+// процесса, а последние строки дописывает обработчик atexit
+struct Logger {
+    int fd = -1;
+    std::mutex queues_mtx;               // Регистрация очередей новых потоков
+    std::vector<LogQueue*> queues;
+    std::mutex drain_mtx;                // Один читатель очередей: поток или atexit
+    std::string batch;
+};
+
+Logger* g_logger = nullptr;
+std::once_flag g_logger_once;
+
+void write_all(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        auto n = log_write(fd, data, size);
+        if (n <= 0) return;
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+}
+
+// Забирает строки из всех очередей и пишет их пачками до LOG_BATCH_SIZE
+void drain_queues() {
+    Logger& logger = *g_logger;
+    std::lock_guard<std::mutex> drain(logger.drain_mtx);
+    std::vector<LogQueue*> queues;
+    {
+        std::lock_guard<std::mutex> lock(logger.queues_mtx);
+        queues = logger.queues;
+    }
+    logger.batch.clear();
+    for (LogQueue* queue : queues) {
+        queue->consumeBatch([&](const LogSlot& slot) {
+            if (logger.batch.size() + slot.length > LOG_BATCH_SIZE) {
+                write_all(logger.fd, logger.batch.data(), logger.batch.size());
+                logger.batch.clear();
+            }
+            logger.batch.append(slot.text, slot.length);
+        });
+    }
+    if (!logger.batch.empty()) write_all(logger.fd, logger.batch.data(), logger.batch.size());
+}
+
+void* flusher_thread(void* /*arg*/) {
+    while (true) {
+        drain_queues();
 #ifdef _WIN32
-    SYSTEMTIME st;
-    GetLocalTime(&st);  // Локальное время
-    oss << std::setfill('0')
-        << std::setw(4) << st.wYear << '-'
-        << std::setw(2) << st.wMonth << '-'
-        << std::setw(2) << st.wDay << ' '
-        << std::setw(2) << st.wHour << ':'
-        << std::setw(2) << st.wMinute << ':'
-        << std::setw(2) << st.wSecond << '.'
-        << std::setw(3) << st.wMilliseconds;
+        Sleep(LOG_FLUSH_MS);
 #else
-    struct timeval tv;
-    gettimeofday(&tv, nullptr);
-    std::tm t;
-    localtime_r(&tv.tv_sec, &t);
-    oss << std::setfill('0')
-        << std::setw(4) << t.tm_year + 1900 << '-'
-        << std::setw(2) << t.tm_mon + 1 << '-'
-        << std::setw(2) << t.tm_mday << ' '
-        << std::setw(2) << t.tm_hour << ':'
-        << std::setw(2) << t.tm_min << ':'
-        << std::setw(2) << t.tm_sec << '.'
-        << std::setw(3) << (tv.tv_usec / 1000);
+        usleep(LOG_FLUSH_MS * 1000);
 #endif
-    return oss.str();
+    }
+    return nullptr;
+}
+
+void start_logger() {
+    g_logger = new Logger();
+    g_logger->fd = log_open("lab3.log");
+    if (g_logger->fd < 0) {
+        std::cerr << "Failed to open log file" << std::endl;
+        return;
+    }
+    std::atexit(log_flush);
+    thread_t flusher{};
+#ifndef _WIN32
+    // Поток наследует маску: сигналы не должны прерывать его, пока он держит drain_mtx
+    sigset_t all, previous;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &previous);
+#endif
+    if (thread_create(&flusher, flusher_thread, nullptr) != 0) {
+        std::cerr << "Failed to start log flusher" << std::endl;
+    }
+#ifndef _WIN32
+    pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+#endif
+}
+
+LogQueue* thread_queue() {
+    thread_local LogQueue* queue = nullptr;
+    if (!queue) {
+        queue = new LogQueue();
+        std::lock_guard<std::mutex> lock(g_logger->queues_mtx);
+        g_logger->queues.push_back(queue);
+    }
+    return queue;
+}
+
+} // namespace
+
+void log_flush() {
+    if (g_logger && g_logger->fd >= 0) drain_queues();
 }
 
 void do_log(const std::string& data) {
@@ -48,14 +154,32 @@ void do_log(const std::string& data) {
 #else
     int pid = static_cast<int>(getpid());
 #endif
-    
-    // Кроссплатформенная блокировка файла
-    std::ofstream file("lab3.log", std::ios::app);
-    if (!file.is_open()) {
-        std::cerr << "Failed to open log file" << std::endl;
-        return;
+
+    std::call_once(g_logger_once, start_logger);
+    if (g_logger->fd < 0) return;
+
+    // "[время] PID=...: " собирается прямо в слоте очереди, без промежуточных строк
+    char head[TIMESTAMP_LENGTH + 32];
+    size_t head_length = 0;
+    head[head_length++] = '[';
+    head_length += format_now(head + head_length);
+    std::memcpy(head + head_length, "] PID=", 6);
+    head_length += 6;
+    head_length += static_cast<size_t>(std::snprintf(head + head_length, sizeof(head) - head_length, "%d: ", pid));
+    size_t length = head_length + data.size() + 1;
+
+    bool queued = length <= LOG_SLOT_SIZE && thread_queue()->tryPush([&](LogSlot& slot) {
+        std::memcpy(slot.text, head, head_length);
+        std::memcpy(slot.text + head_length, data.data(), data.size());
+        slot.text[length - 1] = '\n';
+        slot.length = static_cast<uint32_t>(length);
+    });
+    if (!queued) {
+        // Сначала то, что уже в очередях, — чтобы строки потока не поменялись местами
+        drain_queues();
+        std::string line(head, head_length);
+        line.append(data);
+        line.push_back('\n');
+        write_all(g_logger->fd, line.data(), line.size());
     }
-    
-    file << "[" << time_to_str() << "] PID=" << pid << ": " << data << std::endl;
-    file.flush();
-}
\ No newline at end of file
+}
@@ -1,4 +1,8 @@
 #pragma once
 #include <string>
 std::string time_to_str();
-void do_log(const std::string& data);
\ No newline at end of file
+// Строка "[время] PID=...: data" в lab3.log. Пишет фоновый поток, так что
+// вызов не ждёт диска; строки разных процессов не перемешиваются
+void do_log(const std::string& data);
+// Дописывает в файл всё, что ещё в очередях (вызывается и при выходе из процесса)
+void log_flush();
\ No newline at end of file
@@ -0,0 +1,190 @@
+// Микробенчмарк и дифференциальная проверка validatePacket.
+// legacy:: — дословная копия прежней реализации (substr + stof/stoi);
+// новая обязана давать тот же ответ и то же значение на любых входах.
+#include "utils.h"
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include <cctype>
+#include <stdexcept>
+
+namespace legacy {
+
+// Проверяет, что строка имеет формат: [-]ddd.d (ровно 1 цифра после точки)
+bool isValidTempFormat(const std::string& s) {
+    if (s.empty()) return false;
+
+    size_t start = 0;
+    if (s[0] == '-') {
+        if (s.size() < 4) return false; // минимум "-0.0"
+        start = 1;
+    }
+
+    // Находим точку
+    size_t dotPos = s.find('.', start);
+    if (dotPos == std::string::npos) return false;
+    if (dotPos == start) return false; // нет цифр до точки (".5" — недопустимо)
+    if (dotPos + 2 != s.size()) return false; // должно быть ровно 1 символ после точки
+
+    // Проверяем: все до точки — цифры
+    for (size_t i = start; i < dotPos; ++i) {
+        if (!std::isdigit(static_cast<unsigned char>(s[i]))) {
+            return false;
+        }
+    }
+
+    // Проверяем: один символ после точки — цифра
+    if (!std::isdigit(static_cast<unsigned char>(s[dotPos + 1]))) {
+        return false;
+    }
+
+    return true;
+}
+
+bool validatePacket(const std::string& packet, float& outTemp) {
+    size_t pos = packet.find(';');
+    if (pos == std::string::npos || pos == 0 || pos == packet.size() - 1) {
+        return false;
+    }
+
+    std::string tempStr = packet.substr(0, pos);
+    std::string chkStr = packet.substr(pos + 1);
+
+    // Проверка формата: только до десятых
+    if (!isValidTempFormat(tempStr)) {
+        return false;
+    }
+
+    // Преобразуем температуру
+    try {
+        outTemp = std::stof(tempStr);
+    } catch (...) {
+        return false;
+    }
+
+    // Проверяем чексумму
+    int expected = ::calculateChecksum(tempStr);
+    try {
+        int received = std::stoi(chkStr);
+        return (received == expected);
+    } catch (...) {
+        return false;
+    }
+}
+
+} // namespace legacy
+
+// Корректные пакеты вперемешку с испорченными: так выглядит реальный поток
+static std::vector<std::string> makeStream(size_t count, std::mt19937& gen) {
+    std::uniform_real_distribution<float> temp(-40.0f, 60.0f);
+    std::uniform_int_distribution<int> corrupt(0, 9);
+    std::vector<std::string> packets;
+    packets.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        std::string t = roundToTenth(temp(gen));
+        std::string packet = t + ";" + std::to_string(calculateChecksum(t));
+        if (corrupt(gen) == 0) packet[gen() % packet.size()] = static_cast<char>('0' + gen() % 10);
+        packets.push_back(packet);
+    }
+    return packets;
+}
+
+// Случайные строки из "опасного" алфавита плюс мутации корректных пакетов
+static std::vector<std::string> makeFuzz(size_t count, std::mt19937& gen) {
+    static const char alphabet[] = "0123456789.-+;; \t\rx";
+    std::vector<std::string> inputs = {
+        "", ";", "1;", ";1", "-", "-.0;1", "0.0;", "-0.0;189", "0.0;142", "+1.0;1",
+        "1.0; 142", "1.0;+142", "1.0;142abc", "1.0;-142", "1.0;0000142", "1.0;\t142",
+        "1.00;190", "1.;95", ".5;99", "01.0;190", "1.0;1.0;142", "1.0;99999999999999999999",
+        "1.0;2147483648", "1.0;-2147483648", "99999999999999999999999999999999999999999.0;2000",
+        "340282356779733661637539395458142568447.9;2000",
+        "340282356779733661637539395458142568448.0;2000",
+        "123456789012345678.9;1000", "9007199254740993.1;1000",
+    };
+    std::uniform_int_distribution<int> len(0, 14);
+    for (size_t i = 0; i < count; ++i) {
+        std::string s;
+        int n = len(gen);
+        for (int k = 0; k < n; ++k) s += alphabet[gen() % (sizeof(alphabet) - 1)];
+        inputs.push_back(s);
+    }
+    std::vector<std::string> valid = makeStream(count, gen);
+    for (auto& v : valid) {
+        std::string m = v;
+        switch (gen() % 4) {
+            case 0: m.insert(gen() % (m.size() + 1), 1, alphabet[gen() % (sizeof(alphabet) - 1)]); break;
+            case 1: m.erase(gen() % m.size(), 1); break;
+            case 2: m[gen() % m.size()] = alphabet[gen() % (sizeof(alphabet) - 1)]; break;
+            default: break;
+        }
+        inputs.push_back(m);
+    }
+    // Длинные целые части, где значение уже не влезает в быстрый путь
+    for (int digits = 14; digits <= 45; ++digits) {
+        for (int k = 0; k < 20; ++k) {
+            std::string t;
+            if (gen() % 2) t += '-';
+            t += static_cast<char>('1' + gen() % 9);
+            for (int d = 1; d < digits; ++d) t += static_cast<char>('0' + gen() % 10);
+            t += '.';
+            t += static_cast<char>('0' + gen() % 10);
+            inputs.push_back(t + ";" + std::to_string(calculateChecksum(t)));
+        }
+    }
+    return inputs;
+}
+
+static bool sameResult(const std::string& input) {
+    float oldValue = NAN, newValue = NAN;
+    bool oldOk = legacy::validatePacket(input, oldValue);
+    bool newOk = validatePacket(std::string_view(input), newValue);
+    bool same = oldOk == newOk &&
+                (std::memcmp(&oldValue, &newValue, sizeof(float)) == 0 ||
+                 (std::isnan(oldValue) && std::isnan(newValue)));
+    if (!same) {
+        std::cerr << "MISMATCH on \"" << input << "\": legacy " << oldOk << " " << oldValue
+                  << ", new " << newOk << " " << newValue << "\n";
+    }
+    return same;
+}
+
+template <typename F>
+static double measureNs(const std::vector<std::string>& packets, int rounds, F&& validate, size_t& accepted) {
+    accepted = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        for (const auto& p : packets) {
+            float t;
+            if (validate(p, t)) accepted++;
+        }
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    return ns / (static_cast<double>(packets.size()) * rounds);
+}
+
+int main(int argc, char* argv[]) {
+    size_t count = argc > 1 ? static_cast<size_t>(std::strtoull(argv[1], nullptr, 10)) : 1000000;
+    std::mt19937 gen(12345);
+
+    std::vector<std::string> fuzz = makeFuzz(count, gen);
+    size_t mismatches = 0;
+    for (const auto& input : fuzz) {
+        if (!sameResult(input) && ++mismatches >= 20) break;
+    }
+    std::cout << "Differential check: " << fuzz.size() << " inputs, " << mismatches << " mismatches\n";
+
+    std::vector<std::string> stream = makeStream(count, gen);
+    size_t acceptedOld = 0, acceptedNew = 0;
+    double oldNs = measureNs(stream, 3, [](const std::string& p, float& t) { return legacy::validatePacket(p, t); }, acceptedOld);
+    double newNs = measureNs(stream, 3, [](const std::string& p, float& t) { return validatePacket(std::string_view(p), t); }, acceptedNew);
+    std::cout << "legacy validatePacket: " << oldNs << " ns/packet (" << acceptedOld / 3 << " accepted)\n"
+              << "string_view validatePacket: " << newNs << " ns/packet (" << acceptedNew / 3 << " accepted)\n"
+              << "speedup: " << oldNs / newNs << "x\n";
+
+    return mismatches == 0 && acceptedOld == acceptedNew ? 0 : 1;
+}
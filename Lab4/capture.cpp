@@ -0,0 +1,101 @@
+#include "capture.h"
+#include <cstring>
+
+// Блок длиннее этого — признак испорченного файла, а не реальное чтение порта
+static const uint64_t CAPTURE_MAX_CHUNK = 16 * 1024 * 1024;
+
+static size_t putVarint(unsigned char* out, uint64_t value) {
+    size_t n = 0;
+    while (value >= 0x80) {
+        out[n++] = static_cast<unsigned char>(value | 0x80);
+        value >>= 7;
+    }
+    out[n++] = static_cast<unsigned char>(value);
+    return n;
+}
+
+CaptureWriter::~CaptureWriter() {
+    if (out) std::fclose(out);
+}
+
+bool CaptureWriter::open(const std::string& path) {
+    if (out) std::fclose(out);
+    out = std::fopen(path.c_str(), "wb");
+    if (!out) return false;
+
+    last = lastFlush = std::chrono::steady_clock::now();
+    int64_t startMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    unsigned char header[4 + 1 + 8];
+    std::memcpy(header, CAPTURE_MAGIC, 4);
+    header[4] = CAPTURE_VERSION;
+    std::memcpy(header + 5, &startMs, 8);
+    if (std::fwrite(header, 1, sizeof(header), out) != sizeof(header) || std::fflush(out) != 0) {
+        std::fclose(out);
+        out = nullptr;
+        return false;
+    }
+    return true;
+}
+
+void CaptureWriter::record(const char* data, size_t size) {
+    if (!out || size == 0) return;
+    auto now = std::chrono::steady_clock::now();
+    uint64_t deltaUs = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(now - last).count());
+    last = now;
+
+    unsigned char prefix[20];
+    size_t n = putVarint(prefix, deltaUs);
+    n += putVarint(prefix + n, size);
+    std::fwrite(prefix, 1, n, out);
+    std::fwrite(data, 1, size, out);
+
+    if (now - lastFlush >= std::chrono::milliseconds(CAPTURE_FLUSH_INTERVAL_MS)) {
+        std::fflush(out);
+        lastFlush = now;
+    }
+}
+
+CaptureReader::~CaptureReader() {
+    if (in) std::fclose(in);
+}
+
+bool CaptureReader::open(const std::string& path) {
+    if (in) std::fclose(in);
+    in = std::fopen(path.c_str(), "rb");
+    if (!in) return false;
+
+    unsigned char header[4 + 1 + 8];
+    if (std::fread(header, 1, sizeof(header), in) != sizeof(header) ||
+        std::memcmp(header, CAPTURE_MAGIC, 4) != 0 || header[4] != CAPTURE_VERSION) {
+        std::fclose(in);
+        in = nullptr;
+        return false;
+    }
+    std::memcpy(&startMs, header + 5, 8);
+    offsetUs = 0;
+    return true;
+}
+
+bool CaptureReader::readVarint(uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        int c = std::fgetc(in);
+        if (c == EOF) return false;
+        value |= static_cast<uint64_t>(c & 0x7F) << shift;
+        if (!(c & 0x80)) return true;
+    }
+    return false;
+}
+
+bool CaptureReader::next(CaptureChunk& chunk) {
+    if (!in) return false;
+    uint64_t deltaUs, size;
+    if (!readVarint(deltaUs) || !readVarint(size) || size > CAPTURE_MAX_CHUNK) return false;
+    chunk.data.resize(static_cast<size_t>(size));
+    if (std::fread(&chunk.data[0], 1, chunk.data.size(), in) != chunk.data.size()) return false;
+    offsetUs += deltaUs;
+    chunk.offsetUs = offsetUs;
+    return true;
+}
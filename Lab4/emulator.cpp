@@ -1,47 +1,304 @@
 #include "serial.h"
+#include "pty.h"
 #include "utils.h"
 #include <iostream>
 #include <random>
 #include <thread>
 #include <chrono>
 #include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
 
 #ifdef _WIN32
 #include <windows.h>
 #endif
 
+using Clock = std::chrono::steady_clock;
 
-int main() {
+const double PI = 3.14159265358979323846;
+
+// Модель показаний датчика
+enum class ValueModel { Random, Constant, Sine, Walk };
+
+struct EmulatorOptions {
+    std::vector<std::string> ports;  // пусто — каждому датчику свой псевдотерминал
+    int sensors = 1;
+    double rate = 1.0 / 60.0;        // отсчётов в секунду на датчик
+    ValueModel model = ValueModel::Random;
+    float base = 25.0f;              // центр для constant / sine / walk
+    float amplitude = 10.0f;         // размах sine и границы walk
+    double period = 60.0;            // период sine, с
+    float noise = 0.0f;              // СКО гауссова шума, градусы
+    double corruptRatio = 0.0;       // доля испорченных пакетов
+    double duration = 0.0;           // 0 — без ограничения
+    bool binary = false;
+    int samplesPerFrame = 1;
+};
+
+// Один эмулируемый датчик со своим портом, генератором и расписанием
+struct SimSensor {
+    int id = 0;
+    std::unique_ptr<PseudoTerminal> pty;
+    std::unique_ptr<SerialPort> port;
+    std::string portName;
+    bool connected = false;
+
+    std::mt19937 gen;
+    float walk = 0.0f;
+    Clock::time_point started;   // начало расписания — момент подключения читателя
+    uint64_t sent = 0;           // отсчётов с начала расписания
+    uint64_t total = 0;          // отсчётов за всё время работы
+    uint64_t corrupted = 0;
+    BinaryPacket packet;
+    std::string out;             // пачка на одну запись в порт
+};
+
+static bool parseModel(const std::string& name, ValueModel& model) {
+    if (name == "random") model = ValueModel::Random;
+    else if (name == "constant") model = ValueModel::Constant;
+    else if (name == "sine") model = ValueModel::Sine;
+    else if (name == "walk") model = ValueModel::Walk;
+    else return false;
+    return true;
+}
+
+static float nextValue(SimSensor& sensor, const EmulatorOptions& opt, double t) {
+    float value = opt.base;
+    switch (opt.model) {
+    case ValueModel::Random:
+        value = std::uniform_real_distribution<float>(opt.base - opt.amplitude, opt.base + opt.amplitude)(sensor.gen);
+        break;
+    case ValueModel::Constant:
+        break;
+    case ValueModel::Sine:
+        // Датчики сдвинуты по фазе, чтобы их кривые не совпадали
+        value = opt.base + opt.amplitude * static_cast<float>(std::sin(2.0 * PI * t / opt.period + sensor.id));
+        break;
+    case ValueModel::Walk:
+        sensor.walk += std::normal_distribution<float>(0.0f, 0.1f)(sensor.gen);
+        sensor.walk = std::clamp(sensor.walk, -opt.amplitude, opt.amplitude);
+        value = opt.base + sensor.walk;
+        break;
+    }
+    if (opt.noise > 0.0f) value += std::normal_distribution<float>(0.0f, opt.noise)(sensor.gen);
+    // В пакет попадает "-99.9".."999.9": шире формат не пропустит
+    return std::clamp(value, -99.9f, 999.9f);
+}
+
+// Портит пакет так, как это бывает на линии: неверная контрольная сумма,
+// потерянный байт или мусор вместо части строки
+static void corruptText(std::string& packet, std::mt19937& gen) {
+    size_t pos = std::uniform_int_distribution<size_t>(0, packet.size() - 1)(gen);
+    switch (std::uniform_int_distribution<int>(0, 2)(gen)) {
+    case 0: packet.back() = packet.back() == '9' ? '0' : static_cast<char>(packet.back() + 1); break;
+    case 1: packet.erase(pos, 1); break;
+    default: packet[pos] = static_cast<char>(std::uniform_int_distribution<int>(0x21, 0x7E)(gen)); break;
+    }
+}
+
+// В двоичном кадре меняем один байт данных (не 0x00, чтобы не разрезать кадр)
+static void corruptFrame(std::string& frame, std::mt19937& gen) {
+    if (frame.size() < 3) return;
+    size_t pos = std::uniform_int_distribution<size_t>(1, frame.size() - 2)(gen);
+    char flipped = static_cast<char>(frame[pos] ^ (1 << std::uniform_int_distribution<int>(0, 7)(gen)));
+    frame[pos] = flipped != 0 ? flipped : static_cast<char>(0xFF);
+}
+
+// Собирает в sensor.out все отсчёты, которые по расписанию уже пора отправить
+static void produce(SimSensor& sensor, const EmulatorOptions& opt, Clock::time_point now, bool verbose) {
+    double elapsed = std::chrono::duration<double>(now - sensor.started).count();
+    uint64_t due = static_cast<uint64_t>(elapsed * opt.rate) + 1;  // первый отсчёт — сразу
+    std::bernoulli_distribution corrupt(opt.corruptRatio);
+
+    for (; sensor.sent < due; ++sensor.sent) {
+        double t = static_cast<double>(sensor.sent) / opt.rate;
+        float value = nextValue(sensor, opt, t);
+        sensor.total++;
+
+        if (opt.binary) {
+            // В кадре — десятые доли градуса
+            sensor.packet.samples.push_back(static_cast<int16_t>(std::lround(value * 10.0f)));
+            if (sensor.packet.samples.size() < static_cast<size_t>(opt.samplesPerFrame)) continue;
+            sensor.packet.deviceTimeMs = static_cast<uint32_t>(t * 1000.0);
+            std::string frame = encodeBinaryPacket(sensor.packet);
+            if (opt.corruptRatio > 0.0 && corrupt(sensor.gen)) {
+                corruptFrame(frame, sensor.gen);
+                sensor.corrupted++;
+            }
+            if (verbose) {
+                std::cout << "Sensor " << sensor.id << " sent frame #" << sensor.packet.seq << ": "
+                          << sensor.packet.samples.size() << " samples, " << frame.size() << " bytes\n";
+            }
+            sensor.out += frame;
+            sensor.packet.samples.clear();
+            sensor.packet.seq++;
+        } else {
+            std::string tempStr = roundToTenth(value); // например: "23.4"
+            std::string packet = tempStr + ";" + std::to_string(calculateChecksum(tempStr));
+            if (opt.corruptRatio > 0.0 && corrupt(sensor.gen)) {
+                corruptText(packet, sensor.gen);
+                sensor.corrupted++;
+            }
+            if (verbose) std::cout << "Sensor " << sensor.id << " sent: " << packet << "\n";
+            sensor.out += packet;
+            sensor.out += '\n';
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
 #ifdef _WIN32
     SetConsoleOutputCP(CP_UTF8);
 #endif
-    const std::string PORT_NAME =
+    EmulatorOptions opt;
+    bool usage = false;
+    for (int i = 1; i < argc && !usage; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--port" && hasValue) {
+            opt.ports.push_back(argv[++i]);
+        } else if (arg == "--sensors" && hasValue) {
+            opt.sensors = std::atoi(argv[++i]);
+        } else if (arg == "--rate" && hasValue) {
+            opt.rate = std::atof(argv[++i]);
+        } else if (arg == "--model" && hasValue) {
+            usage = !parseModel(argv[++i], opt.model);
+        } else if (arg == "--base" && hasValue) {
+            opt.base = static_cast<float>(std::atof(argv[++i]));
+        } else if (arg == "--amplitude" && hasValue) {
+            opt.amplitude = static_cast<float>(std::atof(argv[++i]));
+        } else if (arg == "--period" && hasValue) {
+            opt.period = std::atof(argv[++i]);
+        } else if (arg == "--noise" && hasValue) {
+            opt.noise = static_cast<float>(std::atof(argv[++i]));
+        } else if (arg == "--corrupt" && hasValue) {
+            opt.corruptRatio = std::atof(argv[++i]);
+        } else if (arg == "--duration" && hasValue) {
+            opt.duration = std::atof(argv[++i]);
+        } else if (arg == "--binary") {
+            opt.binary = true;
+        } else if (arg == "--samples" && hasValue) {
+            opt.samplesPerFrame = std::atoi(argv[++i]);
+        } else {
+            usage = true;
+        }
+    }
+    if (usage) {
+        std::cerr << "Usage: " << argv[0] << " [--sensors N] [--rate HZ] [--port PATH]...\n"
+                  << "       [--model random|constant|sine|walk] [--base C] [--amplitude C] [--period S]\n"
+                  << "       [--noise C] [--corrupt RATIO] [--duration S] [--binary] [--samples N]\n";
+        return 1;
+    }
 #ifdef _WIN32
-        "COM6";  // эмулятор пишет в COM6
-#else
-        "/dev/pts2"; 
+    // Псевдотерминалов нет — по умолчанию пишем в пару виртуальных COM-портов
+    if (opt.ports.empty()) opt.ports.push_back("COM6");
 #endif
+    if (!opt.ports.empty()) opt.sensors = static_cast<int>(opt.ports.size());
 
-    try {
-        SerialPort port(PORT_NAME);
-        std::cout << "Emulator started. Sending temperature to " << PORT_NAME << " every 60 seconds.\n";
+    if (opt.sensors < 1 || opt.rate <= 0.0 || opt.period <= 0.0 || opt.noise < 0.0f ||
+        opt.corruptRatio < 0.0 || opt.corruptRatio > 1.0) {
+        std::cerr << "--sensors, --rate and --period must be positive, --corrupt in 0..1\n";
+        return 1;
+    }
+    if (opt.samplesPerFrame < 1 || opt.samplesPerFrame > static_cast<int>(BINARY_MAX_SAMPLES)) {
+        std::cerr << "--samples must be in 1.." << BINARY_MAX_SAMPLES << "\n";
+        return 1;
+    }
 
-        // Генератор случайных чисел
+    try {
         std::random_device rd;
-        std::mt19937 gen(rd());
-        std::uniform_real_distribution<float> dis(15.0f, 35.0f);
+        std::vector<SimSensor> sensors(static_cast<size_t>(opt.sensors));
+        for (size_t i = 0; i < sensors.size(); ++i) {
+            SimSensor& sensor = sensors[i];
+            sensor.id = static_cast<int>(i);
+            sensor.gen.seed(rd());
+            sensor.packet.sensorId = static_cast<uint16_t>(i);
+            if (opt.ports.empty()) {
+                sensor.pty = std::make_unique<PseudoTerminal>();
+                sensor.portName = sensor.pty->slaveName();
+            } else {
+                sensor.portName = opt.ports[i];
+                sensor.port = std::make_unique<SerialPort>(sensor.portName);
+                sensor.connected = true;
+                // Расписание отсчитывается от открытия порта, иначе produce() решит,
+                // что отстал на всё время с эпохи steady_clock
+                sensor.started = Clock::now();
+            }
+            std::cout << "Sensor " << sensor.id << ": " << sensor.portName << "\n";
+        }
+
+        // Построчный вывод только на низкой частоте; на нагрузке — сводка раз в секунду
+        const bool verbose = opt.rate * opt.sensors <= 10.0;
+        std::cout << "Emulator started: " << opt.sensors << " sensor(s), " << opt.rate << " Hz each"
+                  << (opt.binary ? " (binary)" : "") << ".\n" << std::flush;
+
+        const auto started = Clock::now();
+        auto nextReport = started + std::chrono::seconds(1);
+        uint64_t reportedSamples = 0;
 
         while (true) {
-            float rawTemp = dis(gen);
-            std::string tempStr = roundToTenth(rawTemp); // например: "23.4"
-            int chk = calculateChecksum(tempStr);
-            std::string packet = tempStr + ";" + std::to_string(chk);
+            auto now = Clock::now();
+            if (opt.duration > 0.0 && now - started >= std::chrono::duration<double>(opt.duration)) break;
+
+            // Ближайший момент, когда какому-то датчику пора слать следующий отсчёт
+            Clock::time_point wake = now + std::chrono::milliseconds(50);
+            for (auto& sensor : sensors) {
+                if (!sensor.connected) {
+                    // Пока порт никто не открыл, расписание не идёт: открытие порта
+                    // сбрасывает входной буфер, и отправленное пропало бы
+                    if (!sensor.pty->waitForPeer(0)) continue;
+                    sensor.connected = true;
+                    sensor.started = now;
+                    std::cout << "Sensor " << sensor.id << ": reader connected\n";
+                    // Начальный 0x00 отделяет первый кадр от того, что было в линии до нас
+                    if (opt.binary) sensor.out.assign(1, '\0');
+                }
 
-            port.writeLine(packet);
-            std::cout << "Sent: " << packet << "\n";
+                produce(sensor, opt, now, verbose);
+                if (!sensor.out.empty()) {
+                    bool ok = true;
+                    if (sensor.pty) ok = sensor.pty->write(sensor.out);
+                    else sensor.port->writeBytes(sensor.out);
+                    sensor.out.clear();
+                    if (!ok) {
+                        std::cout << "Sensor " << sensor.id << ": reader disconnected\n";
+                        sensor.connected = false;
+                        sensor.sent = 0;
+                        sensor.packet.samples.clear();
+                        continue;
+                    }
+                }
+
+                auto due = sensor.started + std::chrono::duration_cast<Clock::duration>(
+                    std::chrono::duration<double>(static_cast<double>(sensor.sent) / opt.rate));
+                wake = std::min(wake, due);
+            }
+
+            if (now >= nextReport) {
+                uint64_t samples = 0, corrupted = 0;
+                for (const auto& sensor : sensors) {
+                    samples += sensor.total;
+                    corrupted += sensor.corrupted;
+                }
+                if (!verbose) {
+                    std::cout << "[Emulator] " << samples << " samples sent, " << (samples - reportedSamples)
+                              << "/s, corrupted " << corrupted << "\n" << std::flush;
+                }
+                reportedSamples = samples;
+                nextReport += std::chrono::seconds(1);
+            }
+
+            // Ждём до абсолютного момента по расписанию: погрешность сна не
+            // накапливается, а если проспали — produce() досылает отставание пачкой
+            std::this_thread::sleep_until(std::min(wake, nextReport));
+        }
 
-            // Ждём 60 секунд
-            std::this_thread::sleep_for(std::chrono::seconds(60));
+        // Не закрываем терминалы, пока читатели не дочитали хвост
+        for (auto& sensor : sensors) {
+            if (sensor.pty && sensor.connected) sensor.pty->drain();
         }
 
     } catch (const std::exception& e) {
@@ -50,4 +307,4 @@ int main() {
     }
 
     return 0;
-}
\ No newline at end of file
+}
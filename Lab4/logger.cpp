@@ -1,173 +1,187 @@
 #include "serial.h"
 #include "utils.h"
+#include "segment_log.h"
+#include "window_agg.h"
 #include <iostream>
 #include <vector>
 #include <ctime>
 #include <string>
 #include <thread>
 #include <chrono>
-#include <fstream>
+#include <memory>
+#include <algorithm>
+#include <cstdlib>
 
-const std::string MEASUREMENTS_FILE = "measurements.log";
-const std::string HOURLY_FILE = "hourly_average.log";
-const std::string DAILY_FILE = "daily_average.log";
-
-// Глобальные переменные для усреднения и очистки
-static std::vector<float> hourlyBuffer;
-static time_t lastCleanup = 0;        // последняя очистка measurements.log
-static time_t lastHourlyCleanup = 0;  // последняя очистка hourly_average.log
-static time_t lastDailyCleanup = 0;   // последняя очистка daily_average.log
+// Журналы — каталоги с двоичными сегментами (см. segment_log.h)
+const std::string MEASUREMENTS_DIR = "measurements";
+const std::string HOURLY_DIR = "hourly_average";
+const std::string DAILY_DIR = "daily_average";
 
 time_t getCurrentTime() {
     return std::time(nullptr);
 }
 
-int getCurrentYear() {
-    std::time_t t = getCurrentTime();
-    std::tm* tm = std::localtime(&t);
-    return tm->tm_year + 1900;
+// Начало текущего года по местному времени: дневные средние храним только за него
+time_t startOfYear(time_t now) {
+    std::tm tm = *std::localtime(&now);
+    tm.tm_mon = 0;
+    tm.tm_mday = 1;
+    tm.tm_hour = 0;
+    tm.tm_min = 0;
+    tm.tm_sec = 0;
+    tm.tm_isdst = -1;
+    return std::mktime(&tm);
 }
 
-std::vector<std::pair<time_t, float>> readLogFile(const std::string& filename) {
-    std::vector<std::pair<time_t, float>> data;
-    std::ifstream in(filename);
-    if (!in.is_open()) return data;
-
-    time_t ts;
-    float val;
-    while (in >> ts >> val) {
-        data.emplace_back(ts, val);
-    }
-    return data;
+// Журналы создаются в main, когда известна политика fdatasync (--sync).
+// Писать в них можно из цикла чтения: запись уходит в очередь фонового писателя
+static std::unique_ptr<SegmentLog> measurementsLog;
+static std::unique_ptr<SegmentLog> hourlyLog;
+static std::unique_ptr<SegmentLog> dailyLog;
+
+// Сроки хранения: измерения — сутки (сегменты по часу), часовые средние —
+// 30 дней (сегменты по суткам), дневные — текущий год (сегменты по 30 дней)
+void openLogs(SyncPolicy policy, int syncIntervalMs) {
+    measurementsLog = std::make_unique<SegmentLog>(MEASUREMENTS_DIR, 3600,
+        [](time_t now) { return now - 24 * 3600; }, policy, syncIntervalMs);
+    hourlyLog = std::make_unique<SegmentLog>(HOURLY_DIR, 24 * 3600,
+        [](time_t now) { return now - 30 * 24 * 3600; }, policy, syncIntervalMs);
+    dailyLog = std::make_unique<SegmentLog>(DAILY_DIR, 30 * 24 * 3600, startOfYear, policy, syncIntervalMs);
 }
 
-void cleanupMeasurementsLog(time_t now) {
-    auto all = readLogFile(MEASUREMENTS_FILE);
-    std::vector<std::pair<time_t, float>> valid;
-    for (const auto& [ts, val] : all) {
-        if (now - ts <= 24 * 3600) {
-            valid.emplace_back(ts, val);
-        }
-    }
-    std::ofstream out(MEASUREMENTS_FILE, std::ios::trunc);
-    for (const auto& [ts, val] : valid) {
-        out << ts << " " << val << "\n";
-    }
-    lastCleanup = now;
+// Основная запись измерения: только дописывание, устаревшие сегменты удаляются целиком.
+// Ошибки записи сообщает фоновый писатель
+void logMeasurement(time_t ts, float temp) {
+    measurementsLog->append(ts, temp);
 }
 
-void cleanupHourlyLog(time_t now) {
-    auto all = readLogFile(HOURLY_FILE);
-    std::vector<std::pair<time_t, float>> valid;
-    for (const auto& [ts, val] : all) {
-        if (now - ts <= 30 * 24 * 3600) {
-            valid.emplace_back(ts, val);
-        }
-    }
-    std::ofstream out(HOURLY_FILE, std::ios::trunc);
-    for (const auto& [ts, val] : valid) {
-        out << ts << " " << val << "\n";
-    }
-    lastHourlyCleanup = now;
+// Средние пишутся с временем начала своего окна
+void logHourlyAverage(time_t windowStart, float avg) {
+    hourlyLog->append(windowStart, avg);
 }
 
-void cleanupDailyLog(time_t now) {
-    int year = getCurrentYear();
-    auto all = readLogFile(DAILY_FILE);
-    std::vector<std::pair<time_t, float>> valid;
-    for (const auto& [ts, val] : all) {
-        std::tm* tm = std::localtime(&ts);
-        if (tm->tm_year + 1900 == year) {
-            valid.emplace_back(ts, val);
-        }
-    }
-    std::ofstream out(DAILY_FILE, std::ios::trunc);
-    for (const auto& [ts, val] : valid) {
-        out << ts << " " << val << "\n";
-    }
-    lastDailyCleanup = now;
-}
-
-// Основная запись измерения — БЕЗ полной перезаписи!
-void logMeasurement(float temp) {
-    time_t now = getCurrentTime();
-    // Просто дописываем в конец
-    std::ofstream out(MEASUREMENTS_FILE, std::ios::app);
-    out << now << " " << temp << "\n";
-
-    // Обрезаем раз в час (3600 сек)
-    if (now - lastCleanup >= 3600 || lastCleanup == 0) {
-        cleanupMeasurementsLog(now);
-    }
-}
-
-void logHourlyAverage(float avg) {
-    time_t now = getCurrentTime();
-    std::ofstream out(HOURLY_FILE, std::ios::app);
-    out << now << " " << avg << "\n";
-
-    // Обрезаем раз в 6 часов (можно и реже)
-    if (now - lastHourlyCleanup >= 6 * 3600 || lastHourlyCleanup == 0) {
-        cleanupHourlyLog(now);
-    }
-}
-
-void logDailyAverage(float avg) {
-    time_t now = getCurrentTime();
-    std::ofstream out(DAILY_FILE, std::ios::app);
-    out << now << " " << avg << "\n";
-
-    // Обрезаем раз в день
-    if (now - lastDailyCleanup >= 24 * 3600 || lastDailyCleanup == 0) {
-        cleanupDailyLog(now);
-    }
+void logDailyAverage(time_t windowStart, float avg) {
+    dailyLog->append(windowStart, avg);
 }
 
 static int totalMeasurements = 0;
 
+// Окна по часам: час и сутки (с местной полуночи, и после перевода часов) и скользящие 10 минут с шагом
+// в минуту. Значения не копятся — в каждом окне только count/sum/min/max/дисперсия.
+// Опоздавшим значениям (время приёма на часах пошло назад) даём 5 секунд
+const time_t WINDOW_LATENESS = 5;
+
+static WindowAggregator hourlyWindows = WindowAggregator::localTime(3600, WINDOW_LATENESS,
+    [](const WindowStats& w) {
+        logHourlyAverage(w.start, static_cast<float>(w.stats.mean));
+        std::cout << "[Hourly avg] " << w.stats.mean << " C (min " << w.stats.min << ", max " << w.stats.max
+                  << ", stddev " << w.stats.stddev() << ", " << w.stats.count << " samples)\n";
+    });
+
+static WindowAggregator dailyWindows = WindowAggregator::localTime(24 * 3600, WINDOW_LATENESS,
+    [](const WindowStats& w) {
+        logDailyAverage(w.start, static_cast<float>(w.stats.mean));
+        std::cout << "[Daily avg] " << w.stats.mean << " C (min " << w.stats.min << ", max " << w.stats.max
+                  << ", " << w.stats.count << " samples)\n";
+    });
+
+static WindowAggregator recentWindows(600, 60, WINDOW_LATENESS, 0,
+    [](const WindowStats& w) {
+        std::cout << "[Last 10 min] " << w.stats.mean << " C (" << w.stats.count << " samples)\n";
+    });
+
 void processTemperature(float temp) {
     time_t now = getCurrentTime();
-    logMeasurement(temp);
+    logMeasurement(now, temp);
     totalMeasurements++;
 
-    hourlyBuffer.push_back(temp);
-
-    if (hourlyBuffer.size() >= 60) {
-        float sum = 0.0f;
-        for (float t : hourlyBuffer) sum += t;
-        float hourlyAvg = sum / static_cast<float>(hourlyBuffer.size());
-
-        logHourlyAverage(hourlyAvg);
-        std::cout << "[Hourly avg] " << hourlyAvg << " C\n";
-
-        static int hourlyBlocks = 0;
-        hourlyBlocks++;
-        if (hourlyBlocks >= 24) {
-            logDailyAverage(hourlyAvg);
-            std::cout << "[Daily avg] " << hourlyAvg << " C\n";
-            hourlyBlocks = 0;
-        }
+    hourlyWindows.add(now, temp);
+    dailyWindows.add(now, temp);
+    recentWindows.add(now, temp);
+}
 
-        hourlyBuffer.clear();
-    }
+// Закрывает окна по часам, даже когда датчик молчит
+void advanceWindows() {
+    time_t now = getCurrentTime();
+    hourlyWindows.advance(now);
+    dailyWindows.advance(now);
+    recentWindows.advance(now);
 }
 
-int main() {
-    const std::string PORT_NAME =
+int main(int argc, char* argv[]) {
+    std::string PORT_NAME =
 #ifdef _WIN32
         "COM5";
 #else
         "/dev/pts1";
 #endif
 
+    // --capture: писать сырой трафик порта в файл для replay
+    // --sync: когда сбрасывать журналы на диск (never | interval | always), --sync-ms: интервал
+    std::string capturePath;
+    SyncPolicy syncPolicy = SyncPolicy::Interval;
+    int syncIntervalMs = 1000;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--port" && i + 1 < argc) {
+            PORT_NAME = argv[++i];
+        } else if (arg == "--capture" && i + 1 < argc) {
+            capturePath = argv[++i];
+        } else if (arg == "--sync" && i + 1 < argc) {
+            std::string mode = argv[++i];
+            if (mode == "never") syncPolicy = SyncPolicy::Never;
+            else if (mode == "interval") syncPolicy = SyncPolicy::Interval;
+            else if (mode == "always") syncPolicy = SyncPolicy::EveryBatch;
+            else {
+                std::cerr << "Unknown sync mode: " << mode << "\n";
+                return 1;
+            }
+        } else if (arg == "--sync-ms" && i + 1 < argc) {
+            syncIntervalMs = std::max(1, std::atoi(argv[++i]));
+        } else {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--port PATH] [--capture FILE] [--sync never|interval|always] [--sync-ms N]\n";
+            return 1;
+        }
+    }
+    openLogs(syncPolicy, syncIntervalMs);
+
     try {
         SerialPort port(PORT_NAME);
         std::cout << "Listening on " << PORT_NAME << "...\n";
+        if (!capturePath.empty()) {
+            if (!port.startCapture(capturePath)) {
+                std::cerr << "Error: cannot create capture " << capturePath << "\n";
+                return 1;
+            }
+            std::cout << "Capturing to " << capturePath << "\n";
+        }
+
+        // Журнал читается через mmap, без разбора текста
+        std::vector<LogRecord> recent;
+        time_t now = getCurrentTime();
+        measurementsLog->read(now - 24 * 3600, now, recent);
+        std::cout << "Measurements in the last 24 h: " << recent.size() << "\n";
 
         while (true) {
             std::string line = port.readLine(2000);
+            advanceWindows();
             if (line.empty()) continue;
 
+            if (port.protocol() == WireProtocol::Binary) {
+                BinaryPacket packet;
+                if (!validatePacket(std::string_view(line), packet)) {
+                    std::cerr << "Invalid binary frame (" << line.size() << " bytes)\n";
+                    continue;
+                }
+                for (int16_t sample : packet.samples) {
+                    float temp = static_cast<float>(sample) / 10.0f;
+                    std::cout << "Received: " << temp << " C\n";
+                    processTemperature(temp);
+                }
+                continue;
+            }
+
             float temp;
             if (!validatePacket(line, temp)) {
                 std::cerr << "Invalid  " << line << "\n";
@@ -0,0 +1,117 @@
+#include "pty.h"
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+#ifndef _WIN32
+    #include <cerrno>
+    #include <cstdlib>
+    #include <fcntl.h>
+    #include <poll.h>
+    #include <sys/ioctl.h>
+    #include <termios.h>
+    #include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+PseudoTerminal::PseudoTerminal() {
+    throw std::runtime_error("Pseudo-terminals are not supported on Windows, use --port with a virtual COM pair");
+}
+
+PseudoTerminal::~PseudoTerminal() = default;
+
+bool PseudoTerminal::waitForPeer(int) { return false; }
+
+bool PseudoTerminal::write(std::string_view) { return false; }
+
+void PseudoTerminal::drain(int) {}
+
+#else
+
+PseudoTerminal::PseudoTerminal() {
+    master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0) throw std::runtime_error("posix_openpt failed");
+    const char* name = nullptr;
+    if (grantpt(master) != 0 || unlockpt(master) != 0 || !(name = ptsname(master))) {
+        close(master);
+        throw std::runtime_error("Cannot set up pseudo-terminal");
+    }
+    slave = name;
+
+    // Сырой режим: байты проходят без эха и без замены \n на \r\n
+    struct termios tty;
+    if (tcgetattr(master, &tty) == 0) {
+        cfmakeraw(&tty);
+        tcsetattr(master, TCSANOW, &tty);
+    }
+
+    // Пока ведомую сторону ни разу не открывали, poll не сообщает POLLHUP.
+    // Открываем и закрываем её сами, чтобы waitForPeer видел момент подключения
+    int fd = open(slave.c_str(), O_RDWR | O_NOCTTY);
+    if (fd >= 0) close(fd);
+}
+
+PseudoTerminal::~PseudoTerminal() {
+    if (master >= 0) close(master);
+}
+
+bool PseudoTerminal::waitForPeer(int timeoutMs) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (true) {
+        struct pollfd pfd = { master, POLLOUT, 0 };
+        if (poll(&pfd, 1, 0) > 0 && !(pfd.revents & POLLHUP)) return true;
+        if (timeoutMs >= 0 && std::chrono::steady_clock::now() >= deadline) return false;
+        // Пока нет читателя, poll возвращается сразу — ждём сами
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+}
+
+bool PseudoTerminal::write(std::string_view data) {
+    size_t written = 0;
+    while (written < data.size()) {
+        // Буфер терминала полон — ждём, пока читатель его разберёт
+        struct pollfd pfd = { master, POLLOUT, 0 };
+        if (poll(&pfd, 1, -1) < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        if (pfd.revents & POLLHUP) return false;
+        ssize_t n = ::write(master, data.data() + written, data.size() - written);
+        if (n < 0) {
+            if (errno == EINTR || errno == EAGAIN) continue;
+            return false;
+        }
+        written += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+void PseudoTerminal::drain(int stallMs) {
+    // Очередь ввода видна только со стороны ведомого: открываем его сами,
+    // ввод при этом не сбрасывается
+    int fd = open(slave.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (fd < 0) return;
+    // Пустая очередь ещё не значит, что всё прочитано: часть байт может лежать
+    // в промежуточном буфере ядра. Ждём, пока она останется пустой 100 мс
+    int pending = 0;
+    int last = -1;
+    int emptyChecks = 0;
+    auto progress = std::chrono::steady_clock::now();
+    while (emptyChecks < 5 && ioctl(fd, FIONREAD, &pending) == 0) {
+        auto now = std::chrono::steady_clock::now();
+        if (pending == 0) {
+            emptyChecks++;
+        } else if (pending != last) {
+            emptyChecks = 0;
+            last = pending;
+            progress = now;
+        } else if (now - progress >= std::chrono::milliseconds(stallMs)) {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    close(fd);
+}
+
+#endif
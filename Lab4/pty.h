@@ -0,0 +1,38 @@
+#ifndef PTY_H
+#define PTY_H
+
+#include <string>
+#include <string_view>
+
+// Псевдотерминал вместо пары виртуальных COM-портов: мы пишем в ведущую
+// сторону, сервер или логгер открывают ведомую (slaveName) как обычный порт.
+// Только POSIX; на Windows конструктор бросает исключение
+class PseudoTerminal {
+public:
+    PseudoTerminal();
+    ~PseudoTerminal();
+
+    PseudoTerminal(const PseudoTerminal&) = delete;
+    PseudoTerminal& operator=(const PseudoTerminal&) = delete;
+
+    // Путь ведомой стороны, например /dev/pts/3
+    const std::string& slaveName() const { return slave; }
+
+    // Ждёт, пока ведомую сторону кто-нибудь откроет; timeoutMs < 0 — без ограничения.
+    // До этого писать бессмысленно: при открытии порт сбрасывает входной буфер
+    bool waitForPeer(int timeoutMs = -1);
+
+    // Пишет всё целиком, блокируясь, если читатель не успевает.
+    // false, если ведомую сторону закрыли
+    bool write(std::string_view data);
+
+    // Ждёт, пока читатель разберёт всё записанное: при закрытии ведущей стороны
+    // непрочитанные байты пропадают. Сдаётся, если очередь не убывает stallMs
+    void drain(int stallMs = 5000);
+
+private:
+    int master = -1;
+    std::string slave;
+};
+
+#endif // PTY_H
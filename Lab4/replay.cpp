@@ -0,0 +1,121 @@
+#include "capture.h"
+#include "pty.h"
+#include "serial.h"
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+// Воспроизводит запись порта (server --capture-dir / logger --capture) в
+// псевдотерминал или в указанный порт. Скорость: 1 — как было, N — в N раз
+// быстрее, max — без пауз, насколько успевает читатель
+int main(int argc, char* argv[]) {
+#ifdef _WIN32
+    SetConsoleOutputCP(CP_UTF8);
+#endif
+    std::string capturePath;
+    std::string portName;
+    double speed = 1.0;  // 0 — max
+    bool loop = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--speed" && i + 1 < argc) {
+            std::string value = argv[++i];
+            speed = value == "max" ? 0.0 : std::atof(value.c_str());
+            if (value != "max" && speed <= 0.0) {
+                std::cerr << "--speed must be a positive number or max\n";
+                return 1;
+            }
+        } else if (arg == "--port" && i + 1 < argc) {
+            portName = argv[++i];
+        } else if (arg == "--loop") {
+            loop = true;
+        } else if (capturePath.empty() && arg[0] != '-') {
+            capturePath = arg;
+        } else {
+            capturePath.clear();
+            break;
+        }
+    }
+    if (capturePath.empty()) {
+        std::cerr << "Usage: " << argv[0] << " FILE [--speed N|max] [--port PATH] [--loop]\n";
+        return 1;
+    }
+
+    CaptureReader reader;
+    if (!reader.open(capturePath)) {
+        std::cerr << "Error: " << capturePath << " is not a serial capture\n";
+        return 1;
+    }
+
+    try {
+        // Куда писать: в существующий порт (пара COM-портов, socat) или в свой псевдотерминал
+        std::unique_ptr<SerialPort> port;
+        std::unique_ptr<PseudoTerminal> pty;
+        std::function<bool(std::string_view)> send;
+        if (!portName.empty()) {
+            port = std::make_unique<SerialPort>(portName);
+            send = [&](std::string_view data) { port->writeBytes(data); return true; };
+        } else {
+            pty = std::make_unique<PseudoTerminal>();
+            std::cout << "Replay port: " << pty->slaveName() << "\n"
+                      << "Waiting for the reader to open it...\n" << std::flush;
+            pty->waitForPeer();
+            send = [&](std::string_view data) { return pty->write(data); };
+        }
+
+        std::cout << "Replaying " << capturePath << " at "
+                  << (speed > 0.0 ? std::to_string(speed) + "x" : std::string("max speed")) << "\n";
+
+        CaptureChunk chunk;
+        size_t chunks = 0;
+        size_t bytes = 0;
+        double maxLagMs = 0.0;
+        const auto started = std::chrono::steady_clock::now();
+        auto passStart = started;
+        while (true) {
+            if (!reader.next(chunk)) {
+                if (!loop || chunks == 0) break;
+                reader.open(capturePath);
+                passStart = std::chrono::steady_clock::now();
+                continue;
+            }
+
+            if (speed > 0.0) {
+                // Ждём до момента по расписанию, а не паузу от предыдущего блока:
+                // задержки записи не накапливаются
+                auto due = passStart + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                    std::chrono::duration<double, std::micro>(chunk.offsetUs / speed));
+                std::this_thread::sleep_until(due);
+                double lagMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - due).count();
+                if (lagMs > maxLagMs) maxLagMs = lagMs;
+            }
+
+            if (!send(chunk.data)) {
+                std::cerr << "Reader closed the port\n";
+                break;
+            }
+            chunks++;
+            bytes += chunk.data.size();
+        }
+
+        double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        std::cout << "Replayed " << chunks << " chunks, " << bytes << " bytes in " << secs << " s";
+        if (secs > 0.0) std::cout << " (" << bytes / secs / 1024.0 << " KiB/s)";
+        if (speed > 0.0) std::cout << ", max lag " << maxLagMs << " ms";
+        std::cout << "\n";
+        // Не закрываем терминал, пока читатель не дочитал хвост
+        if (pty) pty->drain();
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -1,7 +1,11 @@
 #ifndef UTILS_H
 #define UTILS_H
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <vector>
 
 // Округляет float до 1 знака после запятой и возвращает строку вида "23.4"
 std::string roundToTenth(float value);
@@ -11,5 +15,32 @@ int calculateChecksum(const std::string& data);
 
 // Проверяет формат и чексумму, возвращает true при успехе
 bool validatePacket(const std::string& packet, float& outTemp);
+bool validatePacket(std::string_view packet, float& outTemp) noexcept;
+
+// Двоичный протокол. Кадр до кодирования (little-endian):
+//   sensor_id u16 | seq u16 | device_time_ms u32 | count u8 | count * int16 | crc16 u16
+// Отсчёты — десятые доли градуса. CRC-16/CCITT-FALSE считается по всем байтам
+// перед ней. Кадр кодируется COBS и завершается байтом 0x00, которого нет
+// внутри закодированных данных, — по нему поток и режется на кадры.
+const size_t BINARY_MAX_SAMPLES = 255;
+
+struct BinaryPacket {
+    uint16_t sensorId = 0;
+    uint16_t seq = 0;
+    uint32_t deviceTimeMs = 0;
+    std::vector<int16_t> samples;
+};
+
+uint16_t crc16(const uint8_t* data, size_t size);
+
+// COBS: убирает нули из данных ценой не более одного байта на 254
+std::string cobsEncode(const uint8_t* data, size_t size);
+bool cobsDecode(std::string_view encoded, std::vector<uint8_t>& out);
+
+// Готовый кадр для отправки в порт, вместе с завершающим 0x00
+std::string encodeBinaryPacket(const BinaryPacket& packet);
+
+// Разбирает COBS-кадр (без завершающего 0x00), проверяет длину и CRC
+bool validatePacket(std::string_view frame, BinaryPacket& out);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,165 @@
+#include "window_agg.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+void RunningStats::add(double value) {
+    if (count == 0) {
+        min = max = value;
+    } else {
+        min = std::min(min, value);
+        max = std::max(max, value);
+    }
+    count++;
+    sum += value;
+    double delta = value - mean;
+    mean += delta / static_cast<double>(count);
+    m2 += delta * (value - mean);
+}
+
+void RunningStats::merge(const RunningStats& other) {
+    if (other.count == 0) return;
+    if (count == 0) {
+        *this = other;
+        return;
+    }
+    double n = static_cast<double>(count + other.count);
+    double delta = other.mean - mean;
+    mean += delta * static_cast<double>(other.count) / n;
+    m2 += other.m2 + delta * delta * static_cast<double>(count) * static_cast<double>(other.count) / n;
+    count += other.count;
+    sum += other.sum;
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+}
+
+double RunningStats::stddev() const {
+    return std::sqrt(variance());
+}
+
+WindowAggregator::WindowAggregator(time_t width, time_t slide, time_t lateness, time_t offset, WindowFn onWindow)
+    : width_(width), slide_(slide), lateness_(lateness), offset_(offset), onWindow_(std::move(onWindow)) {}
+
+WindowAggregator WindowAggregator::localTime(time_t width, time_t lateness, WindowFn onWindow) {
+    WindowAggregator windows(width, width, lateness, 0, std::move(onWindow));
+    windows.local_ = true;
+    return windows;
+}
+
+static time_t alignWithOffset(time_t ts, time_t slide, time_t offset) {
+    time_t shifted = ts + offset;
+    time_t rem = shifted % slide;
+    if (rem < 0) rem += slide;
+    return shifted - rem - offset;
+}
+
+time_t WindowAggregator::align(time_t ts) const {
+    if (!local_) return alignWithOffset(ts, slide_, offset_);
+
+    // Граница — момент u, когда местные часы показывают кратное slide, то есть
+    // u + localUtcOffset(u) кратно slide. Если между границей и ts переводили
+    // часы, граница лежит по прежнему сдвигу: на шаг раньше или на месте
+    time_t offset = localUtcOffset(ts);
+    time_t start = alignWithOffset(ts, slide_, offset);
+    time_t before = localUtcOffset(start);
+    if (before == offset) return start;
+    time_t earlier = alignWithOffset(ts, slide_, before);
+    if (localUtcOffset(earlier) == before) return earlier;
+    earlier -= slide_;
+    return localUtcOffset(earlier) == before ? earlier : start;
+}
+
+time_t WindowAggregator::paneEnd(time_t start) const {
+    // Местный кусок короче или длиннее slide не больше чем на час перевода часов
+    return local_ ? align(start + slide_ + slide_ / 2) : start + slide_;
+}
+
+time_t WindowAggregator::windowStart(time_t end) const {
+    return local_ ? align(end - 1) : end - width_;
+}
+
+void WindowAggregator::add(time_t ts, double value) {
+    time_t pane = align(ts);
+    // Первое окно значения уже выдано — досчитать его нельзя
+    if (nextEnd_ != 0 && pane < nextEnd_ && paneEnd(pane) < nextEnd_) {
+        late_++;
+        return;
+    }
+    if (nextEnd_ == 0) nextEnd_ = paneEnd(pane);
+
+    // Обычно значение попадает в последний кусок; опоздавшие ищем с конца
+    auto it = panes_.end();
+    while (it != panes_.begin() && std::prev(it)->start > pane) --it;
+    if (it != panes_.begin() && std::prev(it)->start == pane) {
+        std::prev(it)->stats.add(value);
+    } else {
+        Pane fresh{pane, RunningStats()};
+        fresh.stats.add(value);
+        panes_.insert(it, fresh);
+    }
+
+    watermark_ = std::max(watermark_, ts - lateness_);
+    closeWindows();
+}
+
+void WindowAggregator::advance(time_t now) {
+    watermark_ = std::max(watermark_, now - lateness_);
+    closeWindows();
+}
+
+void WindowAggregator::closeWindows() {
+    while (nextEnd_ != 0 && nextEnd_ <= watermark_) {
+        if (panes_.empty()) {
+            // Данных нет: следующее окно к закрытию — первое, не закончившееся к watermark
+            nextEnd_ = paneEnd(align(watermark_));
+            return;
+        }
+        if (panes_.front().start >= nextEnd_) {
+            // Пропускаем окна, в которые не попало ни одного значения
+            nextEnd_ = paneEnd(panes_.front().start);
+            continue;
+        }
+
+        WindowStats window;
+        window.start = windowStart(nextEnd_);
+        window.end = nextEnd_;
+        for (const Pane& pane : panes_) {
+            if (pane.start >= nextEnd_) break;
+            if (pane.start >= window.start) window.stats.merge(pane.stats);
+        }
+        if (window.stats.count > 0 && onWindow_) onWindow_(window);
+
+        nextEnd_ = paneEnd(nextEnd_);
+        time_t keepFrom = windowStart(nextEnd_);
+        while (!panes_.empty() && panes_.front().start < keepFrom) panes_.pop_front();
+    }
+}
+
+// Секунды от 1970-01-01 до полуночи даты по григорианскому календарю
+static long long daysFromCivil(long long y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    long long era = (y >= 0 ? y : y - 399) / 400;
+    unsigned yoe = static_cast<unsigned>(y - era * 400);
+    unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<long long>(doe) - 719468;
+}
+
+time_t localUtcOffset(time_t now) {
+    // Разность показаний местных часов и UTC в момент now
+    std::tm local{};
+    std::tm utc{};
+#ifdef _WIN32
+    localtime_s(&local, &now);
+    gmtime_s(&utc, &now);
+#else
+    localtime_r(&now, &local);
+    gmtime_r(&now, &utc);
+#endif
+    auto seconds = [](const std::tm& t) {
+        return daysFromCivil(t.tm_year + 1900LL, static_cast<unsigned>(t.tm_mon + 1),
+                             static_cast<unsigned>(t.tm_mday)) * 86400 +
+               t.tm_hour * 3600LL + t.tm_min * 60LL + t.tm_sec;
+    };
+    return static_cast<time_t>(seconds(local) - seconds(utc));
+}
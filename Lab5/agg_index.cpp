@@ -0,0 +1,241 @@
+#include "agg_index.h"
+#include <iostream>
+#include <string>
+
+void Aggregate::add(double value) {
+    if (count == 0 || value < min) min = value;
+    if (count == 0 || value > max) max = value;
+    sum += value;
+    count++;
+}
+
+void Aggregate::merge(const Aggregate& other) {
+    if (other.count == 0) return;
+    if (count == 0 || other.min < min) min = other.min;
+    if (count == 0 || other.max > max) max = other.max;
+    sum += other.sum;
+    count += other.count;
+}
+
+long long aggBlockSize(int level) {
+    long long size = AGG_BASE_BLOCK;
+    for (int i = 0; i < level; ++i) size *= AGG_FANOUT;
+    return size;
+}
+
+// Начало блока, содержащего ts (деление с округлением вниз)
+static long long blockStart(long long ts, long long size) {
+    long long q = ts / size;
+    if (ts % size != 0 && ts < 0) q--;
+    return q * size;
+}
+
+static bool execSql(sqlite3* db, const char* sql, const char* what) {
+    char* errMsg = nullptr;
+    if (sqlite3_exec(db, sql, nullptr, nullptr, &errMsg) != SQLITE_OK) {
+        std::cerr << "[DB] Error " << what << ": " << errMsg << "\n";
+        sqlite3_free(errMsg);
+        return false;
+    }
+    return true;
+}
+
+bool initAggregateIndex(sqlite3* db) {
+    const char* sql = R"(
+        CREATE TABLE IF NOT EXISTS aggregate_blocks (
+            sensor_id INTEGER NOT NULL,
+            level INTEGER NOT NULL,
+            block_start INTEGER NOT NULL,
+            count INTEGER NOT NULL,
+            sum REAL NOT NULL,
+            min REAL NOT NULL,
+            max REAL NOT NULL,
+            PRIMARY KEY (sensor_id, level, block_start)
+        ) WITHOUT ROWID;
+    )";
+    if (!execSql(db, sql, "creating aggregate_blocks")) return false;
+
+    // Индекс пуст, а измерения есть — база досталась от старой версии сервера
+    sqlite3_stmt* stmt;
+    const char* check = "SELECT (SELECT COUNT(*) FROM aggregate_blocks) = 0 AND EXISTS (SELECT 1 FROM measurements);";
+    if (sqlite3_prepare_v2(db, check, -1, &stmt, nullptr) != SQLITE_OK) return false;
+    bool needRebuild = sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_int(stmt, 0) != 0;
+    sqlite3_finalize(stmt);
+
+    return needRebuild ? rebuildAggregateIndex(db) : true;
+}
+
+bool rebuildAggregateIndex(sqlite3* db) {
+    if (!execSql(db, "BEGIN;", "starting rebuild")) return false;
+    if (!execSql(db, "DELETE FROM aggregate_blocks;", "clearing aggregate_blocks")) {
+        execSql(db, "ROLLBACK;", "rolling back");
+        return false;
+    }
+
+    // Сырые строки читаем один раз — для уровня 0, каждый следующий уровень
+    // собирается из блоков предыдущего
+    const char* baseSql = R"(
+        INSERT INTO aggregate_blocks (sensor_id, level, block_start, count, sum, min, max)
+        SELECT sensor_id, 0, (timestamp / ?1) * ?1, COUNT(*), SUM(temperature), MIN(temperature), MAX(temperature)
+        FROM measurements
+        GROUP BY sensor_id, timestamp / ?1;
+    )";
+    const char* upperSql = R"(
+        INSERT INTO aggregate_blocks (sensor_id, level, block_start, count, sum, min, max)
+        SELECT sensor_id, ?1, (block_start / ?2) * ?2, SUM(count), SUM(sum), MIN(min), MAX(max)
+        FROM aggregate_blocks
+        WHERE level = ?1 - 1
+        GROUP BY sensor_id, block_start / ?2;
+    )";
+    sqlite3_stmt* base;
+    sqlite3_stmt* upper;
+    if (sqlite3_prepare_v2(db, baseSql, -1, &base, nullptr) != SQLITE_OK) {
+        execSql(db, "ROLLBACK;", "rolling back");
+        return false;
+    }
+    if (sqlite3_prepare_v2(db, upperSql, -1, &upper, nullptr) != SQLITE_OK) {
+        sqlite3_finalize(base);
+        execSql(db, "ROLLBACK;", "rolling back");
+        return false;
+    }
+
+    sqlite3_bind_int64(base, 1, aggBlockSize(0));
+    bool ok = sqlite3_step(base) == SQLITE_DONE;
+    for (int level = 1; level < AGG_LEVELS && ok; ++level) {
+        sqlite3_bind_int(upper, 1, level);
+        sqlite3_bind_int64(upper, 2, aggBlockSize(level));
+        ok = sqlite3_step(upper) == SQLITE_DONE;
+        sqlite3_reset(upper);
+    }
+    sqlite3_finalize(base);
+    sqlite3_finalize(upper);
+    if (!ok) {
+        std::cerr << "[DB] Error rebuilding aggregate_blocks: " << sqlite3_errmsg(db) << "\n";
+        execSql(db, "ROLLBACK;", "rolling back");
+        return false;
+    }
+
+    if (!execSql(db, "COMMIT;", "committing rebuild")) return false;
+    std::cout << "[DB] Aggregate index rebuilt\n";
+    return true;
+}
+
+bool addToAggregateIndex(sqlite3* db, int sensorId, time_t ts, double value) {
+    const char* sql = R"(
+        INSERT INTO aggregate_blocks (sensor_id, level, block_start, count, sum, min, max)
+        VALUES (?1, ?2, ?3, 1, ?4, ?4, ?4)
+        ON CONFLICT (sensor_id, level, block_start) DO UPDATE SET
+            count = count + 1,
+            sum = sum + excluded.sum,
+            min = MIN(min, excluded.min),
+            max = MAX(max, excluded.max);
+    )";
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) return false;
+
+    bool ok = true;
+    for (int level = 0; level < AGG_LEVELS && ok; ++level) {
+        sqlite3_bind_int(stmt, 1, sensorId);
+        sqlite3_bind_int(stmt, 2, level);
+        sqlite3_bind_int64(stmt, 3, blockStart(static_cast<long long>(ts), aggBlockSize(level)));
+        sqlite3_bind_double(stmt, 4, value);
+        ok = sqlite3_step(stmt) == SQLITE_DONE;
+        sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(stmt);
+    return ok;
+}
+
+// Выполняет запрос вида SELECT count, sum, min, max ... и добавляет результат в out
+static bool mergeRow(sqlite3_stmt* stmt, Aggregate& out) {
+    int rc = sqlite3_step(stmt);
+    if (rc == SQLITE_ROW && sqlite3_column_int64(stmt, 0) > 0) {
+        Aggregate part;
+        part.count = sqlite3_column_int64(stmt, 0);
+        part.sum = sqlite3_column_double(stmt, 1);
+        part.min = sqlite3_column_double(stmt, 2);
+        part.max = sqlite3_column_double(stmt, 3);
+        out.merge(part);
+    }
+    sqlite3_reset(stmt);
+    return rc == SQLITE_ROW || rc == SQLITE_DONE;
+}
+
+bool queryAggregate(sqlite3* db, int sensorId, time_t start, time_t end, Aggregate& out) {
+    out = Aggregate{};
+    if (end < start) return true;
+
+    const char* rawSql =
+        "SELECT COUNT(*), SUM(temperature), MIN(temperature), MAX(temperature) "
+        "FROM measurements WHERE sensor_id = ? AND timestamp BETWEEN ? AND ?;";
+    const char* blockSql =
+        "SELECT SUM(count), SUM(sum), MIN(min), MAX(max) "
+        "FROM aggregate_blocks WHERE sensor_id = ? AND level = ? AND block_start BETWEEN ? AND ?;";
+    sqlite3_stmt* raw = nullptr;
+    sqlite3_stmt* blocks = nullptr;
+    if (sqlite3_prepare_v2(db, rawSql, -1, &raw, nullptr) != SQLITE_OK ||
+        sqlite3_prepare_v2(db, blockSql, -1, &blocks, nullptr) != SQLITE_OK) {
+        sqlite3_finalize(raw);
+        sqlite3_finalize(blocks);
+        return false;
+    }
+
+    // Идём слева направо, каждый раз беря самый крупный выровненный блок,
+    // который целиком помещается в остаток диапазона. Подряд идущие блоки
+    // одного уровня собираем в серию и читаем одним запросом по диапазону.
+    bool ok = true;
+    long long cur = start;
+    const long long last = end;
+    int runLevel = -1;
+    long long runFirst = 0, runLast = 0;
+
+    auto flushRun = [&]() {
+        if (runLevel < 0) return;
+        sqlite3_bind_int(blocks, 1, sensorId);
+        sqlite3_bind_int(blocks, 2, runLevel);
+        sqlite3_bind_int64(blocks, 3, runFirst);
+        sqlite3_bind_int64(blocks, 4, runLast);
+        ok = mergeRow(blocks, out) && ok;
+        runLevel = -1;
+    };
+
+    while (ok && cur <= last) {
+        int level = -1;
+        for (int l = AGG_LEVELS - 1; l >= 0; --l) {
+            long long size = aggBlockSize(l);
+            if (blockStart(cur, size) == cur && last - cur >= size - 1) {
+                level = l;
+                break;
+            }
+        }
+
+        if (level < 0) {
+            // Неполный край: досчитываем по сырым строкам до границы базового блока
+            flushRun();
+            long long spanEnd = blockStart(cur, AGG_BASE_BLOCK) + AGG_BASE_BLOCK - 1;
+            if (spanEnd > last) spanEnd = last;
+            sqlite3_bind_int(raw, 1, sensorId);
+            sqlite3_bind_int64(raw, 2, cur);
+            sqlite3_bind_int64(raw, 3, spanEnd);
+            ok = mergeRow(raw, out) && ok;
+            if (spanEnd == last) break;
+            cur = spanEnd + 1;
+            continue;
+        }
+
+        if (level != runLevel) {
+            flushRun();
+            runLevel = level;
+            runFirst = cur;
+        }
+        runLast = cur;
+        long long size = aggBlockSize(level);
+        if (last - cur < size) break;  // блок закрыл диапазон до конца
+        cur += size;
+    }
+    flushRun();
+
+    sqlite3_finalize(raw);
+    sqlite3_finalize(blocks);
+    return ok;
+}
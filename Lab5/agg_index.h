@@ -0,0 +1,42 @@
+#ifndef AGG_INDEX_H
+#define AGG_INDEX_H
+
+#include <ctime>
+#include <sqlite3.h>
+
+// Итоги по диапазону: количество, сумма, минимум и максимум
+struct Aggregate {
+    long long count = 0;
+    double sum = 0.0;
+    double min = 0.0;
+    double max = 0.0;
+
+    void add(double value);
+    void merge(const Aggregate& other);
+    double average() const { return count > 0 ? sum / static_cast<double>(count) : 0.0; }
+};
+
+// Иерархический индекс агрегатов (таблица aggregate_blocks).
+// Уровень 0 — блоки по AGG_BASE_BLOCK секунд, каждый следующий в AGG_FANOUT раз крупнее.
+// Любой диапазон раскладывается на O(log n) выровненных блоков плюс два
+// неполных края, которые досчитываются по сырым строкам measurements.
+const int AGG_LEVELS = 8;
+const long long AGG_BASE_BLOCK = 60;
+const int AGG_FANOUT = 8;
+
+// Размер блока уровня level в секундах
+long long aggBlockSize(int level);
+
+// Создаёт таблицу; если она пуста, а измерения уже есть — строит индекс по ним
+bool initAggregateIndex(sqlite3* db);
+
+// Полностью пересобирает индекс по таблице measurements
+bool rebuildAggregateIndex(sqlite3* db);
+
+// Учитывает одно измерение во всех уровнях. Вызывать в той же транзакции, что и INSERT
+bool addToAggregateIndex(sqlite3* db, int sensorId, time_t ts, double value);
+
+// Итоги по [start, end] (включительно)
+bool queryAggregate(sqlite3* db, int sensorId, time_t start, time_t end, Aggregate& out);
+
+#endif // AGG_INDEX_H
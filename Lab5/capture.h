@@ -0,0 +1,65 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+// Запись сырого трафика порта для разбора инцидентов и нагрузочных прогонов.
+// Файл: заголовок "SCAP" | версия (1 байт) | время начала записи, мс Unix (8 байт),
+// дальше блоки: varint(мкс от предыдущего блока) | varint(длина) | байты.
+// Блок — то, что вернул один read() порта; время — монотонное (steady_clock)
+const char CAPTURE_MAGIC[4] = {'S', 'C', 'A', 'P'};
+const uint8_t CAPTURE_VERSION = 1;
+const int CAPTURE_FLUSH_INTERVAL_MS = 200;
+
+class CaptureWriter {
+public:
+    CaptureWriter() = default;
+    ~CaptureWriter();
+
+    CaptureWriter(const CaptureWriter&) = delete;
+    CaptureWriter& operator=(const CaptureWriter&) = delete;
+
+    bool open(const std::string& path);
+    // Дописывает блок принятых байт с текущим монотонным временем.
+    // На диск уходит не реже раза в CAPTURE_FLUSH_INTERVAL_MS
+    void record(const char* data, size_t size);
+
+private:
+    std::FILE* out = nullptr;
+    std::chrono::steady_clock::time_point last;
+    std::chrono::steady_clock::time_point lastFlush;
+};
+
+// Один блок записи: смещение от начала записи и принятые байты
+struct CaptureChunk {
+    uint64_t offsetUs = 0;
+    std::string data;
+};
+
+class CaptureReader {
+public:
+    CaptureReader() = default;
+    ~CaptureReader();
+
+    CaptureReader(const CaptureReader&) = delete;
+    CaptureReader& operator=(const CaptureReader&) = delete;
+
+    // false, если файла нет или это не запись порта
+    bool open(const std::string& path);
+    // Следующий блок; false в конце файла или на оборванном блоке
+    bool next(CaptureChunk& chunk);
+
+    int64_t startUnixMs() const { return startMs; }
+
+private:
+    bool readVarint(uint64_t& value);
+
+    std::FILE* in = nullptr;
+    int64_t startMs = 0;
+    uint64_t offsetUs = 0;
+};
+
+#endif // CAPTURE_H
@@ -0,0 +1,194 @@
+#include "database.h"
+#include "agg_index.h"
+#include "quantile_sketch.h"
+#include <iostream>
+#include <cstring>
+
+bool addSensorColumn(sqlite3* db, const std::string& table) {
+    std::string pragma = "PRAGMA table_info(" + table + ");";
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, pragma.c_str(), -1, &stmt, nullptr) != SQLITE_OK) return false;
+    bool found = false;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        const char* name = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
+        if (name && std::strcmp(name, "sensor_id") == 0) found = true;
+    }
+    sqlite3_finalize(stmt);
+    if (found) return true;
+
+    std::string sql = "ALTER TABLE " + table + " ADD COLUMN sensor_id INTEGER NOT NULL DEFAULT 0;";
+    char* errMsg = nullptr;
+    if (sqlite3_exec(db, sql.c_str(), nullptr, nullptr, &errMsg) != SQLITE_OK) {
+        std::cerr << "[DB] Error migrating " << table << ": " << errMsg << "\n";
+        sqlite3_free(errMsg);
+        return false;
+    }
+    std::cout << "[DB] Added sensor_id to " << table << "\n";
+    return true;
+}
+
+bool initDatabase(const char* path) {
+    sqlite3* db;
+    int rc = sqlite3_open(path, &db);
+    if (rc != SQLITE_OK) {
+        std::cerr << "[DB] Cannot open database: " << sqlite3_errmsg(db) << "\n";
+        sqlite3_close(db);
+        return false;
+    }
+
+    // WAL: читатели (запросы, снимки) не блокируют запись измерений
+    char* walErr = nullptr;
+    if (sqlite3_exec(db, "PRAGMA journal_mode = WAL;", nullptr, nullptr, &walErr) != SQLITE_OK) {
+        std::cerr << "[DB] Cannot enable WAL: " << walErr << "\n";
+        sqlite3_free(walErr);
+    }
+
+    const char* sql1 = R"(
+        CREATE TABLE IF NOT EXISTS measurements (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            sensor_id INTEGER NOT NULL DEFAULT 0,
+            timestamp INTEGER NOT NULL,
+            temperature REAL NOT NULL
+        );
+    )";
+
+    const char* sql2 = R"(
+        CREATE TABLE IF NOT EXISTS hourly_averages (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            sensor_id INTEGER NOT NULL DEFAULT 0,
+            timestamp INTEGER NOT NULL,
+            average REAL NOT NULL
+        );
+    )";
+
+    const char* sql3 = R"(
+        CREATE TABLE IF NOT EXISTS daily_averages (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            sensor_id INTEGER NOT NULL DEFAULT 0,
+            timestamp INTEGER NOT NULL,
+            average REAL NOT NULL
+        );
+    )";
+
+    char* errMsg = nullptr;
+    rc = sqlite3_exec(db, sql1, nullptr, nullptr, &errMsg);
+    if (rc != SQLITE_OK) {
+        std::cerr << "[DB] Error creating measurements: " << errMsg << "\n";
+        sqlite3_free(errMsg);
+        sqlite3_close(db);
+        return false;
+    }
+
+    rc = sqlite3_exec(db, sql2, nullptr, nullptr, &errMsg);
+    if (rc != SQLITE_OK) {
+        std::cerr << "[DB] Error creating hourly_averages: " << errMsg << "\n";
+        sqlite3_free(errMsg);
+        sqlite3_close(db);
+        return false;
+    }
+
+    rc = sqlite3_exec(db, sql3, nullptr, nullptr, &errMsg);
+    if (rc != SQLITE_OK) {
+        std::cerr << "[DB] Error creating daily_averages: " << errMsg << "\n";
+        sqlite3_free(errMsg);
+        sqlite3_close(db);
+        return false;
+    }
+
+    const char* sql4 = R"(
+        CREATE TABLE IF NOT EXISTS spool_state (
+            id INTEGER PRIMARY KEY CHECK (id = 0),
+            last_seq INTEGER NOT NULL
+        );
+        INSERT OR IGNORE INTO spool_state (id, last_seq) VALUES (0, 0);
+    )";
+    rc = sqlite3_exec(db, sql4, nullptr, nullptr, &errMsg);
+    if (rc != SQLITE_OK) {
+        std::cerr << "[DB] Error creating spool_state: " << errMsg << "\n";
+        sqlite3_free(errMsg);
+        sqlite3_close(db);
+        return false;
+    }
+
+    // Базы, созданные до появления sensor_id, дополняем колонкой (все старые данные — датчик 0)
+    for (const char* table : {"measurements", "hourly_averages", "daily_averages"}) {
+        if (!addSensorColumn(db, table)) {
+            sqlite3_close(db);
+            return false;
+        }
+    }
+
+    if (!createIndexes(db)) {
+        sqlite3_close(db);
+        return false;
+    }
+
+    if (!initAggregateIndex(db) || !initHourlySketches(db)) {
+        sqlite3_close(db);
+        return false;
+    }
+
+    sqlite3_close(db);
+    std::cout << "[DB] Database initialized\n";
+    return true;
+}
+
+bool createIndexes(sqlite3* db) {
+    const char* sql = R"(
+        CREATE INDEX IF NOT EXISTS idx_measurements_sensor_time ON measurements (sensor_id, timestamp);
+        CREATE INDEX IF NOT EXISTS idx_hourly_sensor_time ON hourly_averages (sensor_id, timestamp);
+        CREATE INDEX IF NOT EXISTS idx_daily_sensor_time ON daily_averages (sensor_id, timestamp);
+    )";
+    char* errMsg = nullptr;
+    if (sqlite3_exec(db, sql, nullptr, nullptr, &errMsg) != SQLITE_OK) {
+        std::cerr << "[DB] Error creating indexes: " << errMsg << "\n";
+        sqlite3_free(errMsg);
+        return false;
+    }
+    return true;
+}
+
+bool dropIndexes(sqlite3* db) {
+    const char* sql = R"(
+        DROP INDEX IF EXISTS idx_measurements_sensor_time;
+        DROP INDEX IF EXISTS idx_hourly_sensor_time;
+        DROP INDEX IF EXISTS idx_daily_sensor_time;
+    )";
+    char* errMsg = nullptr;
+    if (sqlite3_exec(db, sql, nullptr, nullptr, &errMsg) != SQLITE_OK) {
+        std::cerr << "[DB] Error dropping indexes: " << errMsg << "\n";
+        sqlite3_free(errMsg);
+        return false;
+    }
+    return true;
+}
+
+bool readSpoolPosition(const char* path, uint64_t& lastSeq) {
+    sqlite3* db;
+    if (sqlite3_open(path, &db) != SQLITE_OK) {
+        std::cerr << "[DB] Cannot open database: " << sqlite3_errmsg(db) << "\n";
+        sqlite3_close(db);
+        return false;
+    }
+    sqlite3_stmt* stmt;
+    bool ok = sqlite3_prepare_v2(db, "SELECT last_seq FROM spool_state WHERE id = 0;", -1, &stmt, nullptr) == SQLITE_OK;
+    if (ok) {
+        ok = sqlite3_step(stmt) == SQLITE_ROW;
+        if (ok) lastSeq = static_cast<uint64_t>(sqlite3_column_int64(stmt, 0));
+        sqlite3_finalize(stmt);
+    }
+    if (!ok) std::cerr << "[DB] Cannot read spool_state: " << sqlite3_errmsg(db) << "\n";
+    sqlite3_close(db);
+    return ok;
+}
+
+bool writeSpoolPosition(sqlite3* db, uint64_t lastSeq) {
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, "UPDATE spool_state SET last_seq = ? WHERE id = 0;", -1, &stmt, nullptr) != SQLITE_OK) {
+        return false;
+    }
+    sqlite3_bind_int64(stmt, 1, static_cast<sqlite3_int64>(lastSeq));
+    bool ok = sqlite3_step(stmt) == SQLITE_DONE;
+    sqlite3_finalize(stmt);
+    return ok;
+}
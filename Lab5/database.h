@@ -0,0 +1,26 @@
+#ifndef DATABASE_H
+#define DATABASE_H
+
+#include <cstdint>
+#include <string>
+#include <sqlite3.h>
+
+// Создаёт таблицы, индексы и служебные структуры (агрегаты, скетчи),
+// при необходимости мигрирует базу старого формата
+bool initDatabase(const char* path);
+
+// Добавляет колонку sensor_id в таблицу старого формата, если её ещё нет
+bool addSensorColumn(sqlite3* db, const std::string& table);
+
+// Индексы по (sensor_id, timestamp). Массовая загрузка удаляет их на время
+// вставки (dropIndexes) и строит заново одним проходом
+bool createIndexes(sqlite3* db);
+bool dropIndexes(sqlite3* db);
+
+// Позиция спула: seq последнего измерения, перенесённого в БД (таблица spool_state)
+bool readSpoolPosition(const char* path, uint64_t& lastSeq);
+
+// Обновляет позицию; вызывать в той же транзакции, что и вставку измерений
+bool writeSpoolPosition(sqlite3* db, uint64_t lastSeq);
+
+#endif // DATABASE_H
@@ -0,0 +1,85 @@
+#include "hot_tier.h"
+#include <algorithm>
+#include <stdexcept>
+
+HotTier::HotTier(time_t horizonSec, size_t capacity)
+    : timestamps_(capacity), values_(capacity), capacity_(capacity), horizon_(horizonSec) {
+    if (capacity == 0 || horizonSec <= 0) {
+        throw std::invalid_argument("HotTier: capacity and horizon must be positive");
+    }
+    coveredFrom_ = std::time(nullptr) - horizon_;
+}
+
+void HotTier::reset(time_t coveredFrom) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    head_ = 0;
+    size_ = 0;
+    coveredFrom_ = coveredFrom;
+}
+
+void HotTier::evictOldest() {
+    // После вытеснения буфер больше не полон для этой секунды:
+    // в ней могли остаться другие измерения, поэтому сдвигаемся на +1
+    time_t evicted = static_cast<time_t>(timestamps_[head_]);
+    coveredFrom_ = std::max(coveredFrom_, evicted + 1);
+    head_ = (head_ + 1) % capacity_;
+    --size_;
+}
+
+void HotTier::push(time_t ts, float value) {
+    std::lock_guard<std::mutex> lock(mtx_);
+
+    // Часы ушли назад — порядок нарушен, начинаем заново (запросы уйдут в БД)
+    if (size_ > 0 && ts < static_cast<time_t>(timestamps_[physical(size_ - 1)])) {
+        head_ = 0;
+        size_ = 0;
+        coveredFrom_ = ts;
+    }
+
+    while (size_ > 0 && static_cast<time_t>(timestamps_[head_]) < ts - horizon_) {
+        evictOldest();
+    }
+    if (size_ == capacity_) {
+        evictOldest();
+    }
+
+    size_t pos = physical(size_);
+    timestamps_[pos] = static_cast<int64_t>(ts);
+    values_[pos] = value;
+    ++size_;
+}
+
+bool HotTier::query(time_t start, time_t end, std::vector<std::pair<time_t, float>>& out) const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (start < coveredFrom_) return false;
+    if (end < start) return true;
+
+    // Бинарный поиск первого элемента с ts >= start по логическим индексам
+    size_t lo = 0, hi = size_;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (timestamps_[physical(mid)] < start) lo = mid + 1;
+        else hi = mid;
+    }
+
+    for (size_t i = lo; i < size_; ++i) {
+        size_t pos = physical(i);
+        if (timestamps_[pos] > end) break;
+        out.emplace_back(static_cast<time_t>(timestamps_[pos]), values_[pos]);
+    }
+    return true;
+}
+
+bool HotTier::last(time_t& ts, float& value) const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (size_ == 0) return false;
+    size_t pos = physical(size_ - 1);
+    ts = static_cast<time_t>(timestamps_[pos]);
+    value = values_[pos];
+    return true;
+}
+
+time_t HotTier::coveredFrom() const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return coveredFrom_;
+}
@@ -0,0 +1,52 @@
+#ifndef HOT_TIER_H
+#define HOT_TIER_H
+
+#include <ctime>
+#include <cstdint>
+#include <cstddef>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// Кольцевой буфер последних измерений в памяти ("горячий" слой).
+// Метки времени и значения лежат в двух непрерывных массивах одинаковой длины.
+// Буфер хранит все измерения начиная с coveredFrom(), поэтому любой запрос
+// с start >= coveredFrom() можно обслужить без обращения к SQLite.
+class HotTier {
+public:
+    HotTier(time_t horizonSec, size_t capacity);
+
+    HotTier(const HotTier&) = delete;
+    HotTier& operator=(const HotTier&) = delete;
+
+    // Сбрасывает буфер: дальше он считается полным начиная с coveredFrom
+    void reset(time_t coveredFrom);
+
+    // Добавляет измерение; старые (за горизонтом или при переполнении) вытесняются
+    void push(time_t ts, float value);
+
+    // Копирует измерения из [start, end] в out. Возвращает false,
+    // если диапазон выходит за пределы буфера и нужен запрос к БД
+    bool query(time_t start, time_t end, std::vector<std::pair<time_t, float>>& out) const;
+
+    // Последнее измерение; false, если буфер пуст
+    bool last(time_t& ts, float& value) const;
+
+    time_t horizon() const { return horizon_; }
+    time_t coveredFrom() const;
+
+private:
+    size_t physical(size_t i) const { return (head_ + i) % capacity_; }
+    void evictOldest();
+
+    mutable std::mutex mtx_;
+    std::vector<int64_t> timestamps_;
+    std::vector<float> values_;
+    size_t capacity_;
+    size_t head_ = 0;   // индекс самого старого элемента
+    size_t size_ = 0;
+    time_t horizon_;
+    time_t coveredFrom_ = 0;
+};
+
+#endif // HOT_TIER_H
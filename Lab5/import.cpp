@@ -0,0 +1,405 @@
+// Массовый импорт логов Lab4 в базу сервера: каталогов с двоичными сегментами
+// (measurements/, hourly_average/, daily_average/, см. segment_log.h) или
+// прежних текстовых файлов (measurements.log и т.д.).
+//
+// Файлы отображаются в память, режутся на куски по границам строк и
+// разбираются параллельно (std::from_chars). Один поток пишет готовые куски
+// в SQLite подготовленным INSERT большими транзакциями. Индексы на время
+// загрузки удаляются и строятся заново в конце, после чего пересчитываются
+// агрегаты и часовые скетчи.
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <charconv>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <memory>
+#include <sqlite3.h>
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+#include "database.h"
+#include "agg_index.h"
+#include "quantile_sketch.h"
+#include "segment_log.h"
+
+// Файл, отображённый в память только для чтения
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) {
+#ifdef _WIN32
+        file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                            OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file_ == INVALID_HANDLE_VALUE) return;
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file_, &size) || size.QuadPart == 0) return;
+        size_ = static_cast<size_t>(size.QuadPart);
+        mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping_) return;
+        data_ = static_cast<const char*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+#else
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) {
+            close(fd);
+            return;
+        }
+        size_ = static_cast<size_t>(st.st_size);
+        void* p = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (p == MAP_FAILED) return;
+        madvise(p, size_, MADV_SEQUENTIAL);
+        data_ = static_cast<const char*>(p);
+#endif
+    }
+
+    ~MappedFile() {
+#ifdef _WIN32
+        if (data_) UnmapViewOfFile(data_);
+        if (mapping_) CloseHandle(mapping_);
+        if (file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+#else
+        if (data_) munmap(const_cast<char*>(data_), size_);
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const { return data_; }
+    size_t size() const { return data_ ? size_ : 0; }
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+#ifdef _WIN32
+    HANDLE file_ = INVALID_HANDLE_VALUE;
+    HANDLE mapping_ = nullptr;
+#endif
+};
+
+// Разобранный кусок файла в виде колонок
+struct ParsedChunk {
+    std::vector<int64_t> timestamps;
+    std::vector<float> values;
+    size_t badLines = 0;
+    bool ready = false;
+};
+
+// Разбирает строки вида "<timestamp> <value>" из [begin, end)
+static void parseChunk(const char* begin, const char* end, ParsedChunk& out) {
+    out.timestamps.reserve(static_cast<size_t>(end - begin) / 16);
+    out.values.reserve(static_cast<size_t>(end - begin) / 16);
+
+    const char* p = begin;
+    while (p < end) {
+        const char* eol = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+        if (!eol) eol = end;
+
+        const char* q = p;
+        while (q < eol && (*q == ' ' || *q == '\t')) ++q;
+        int64_t ts = 0;
+        float value = 0.0f;
+        auto r1 = std::from_chars(q, eol, ts);
+        bool ok = r1.ec == std::errc() && r1.ptr < eol && (*r1.ptr == ' ' || *r1.ptr == '\t');
+        if (ok) {
+            q = r1.ptr;
+            while (q < eol && (*q == ' ' || *q == '\t')) ++q;
+            auto r2 = std::from_chars(q, eol, value);
+            ok = r2.ec == std::errc();
+            q = r2.ptr;
+            while (ok && q < eol && (*q == ' ' || *q == '\t' || *q == '\r')) ++q;
+            ok = ok && q == eol;
+        }
+
+        if (ok) {
+            out.timestamps.push_back(ts);
+            out.values.push_back(value);
+        } else if (eol > p && !(eol - p == 1 && *p == '\r')) {
+            out.badLines++;
+        }
+        p = eol + 1;
+    }
+}
+
+// Записи двоичного сегмента; записи с неверной CRC считаются плохими строками
+static void parseSegment(const char* begin, const char* end, ParsedChunk& out) {
+    size_t count = static_cast<size_t>(end - begin) / LOG_RECORD_SIZE;
+    out.timestamps.reserve(count);
+    out.values.reserve(count);
+    LogRecord record;
+    for (size_t i = 0; i < count; ++i) {
+        if (decodeLogRecord(reinterpret_cast<const unsigned char*>(begin) + i * LOG_RECORD_SIZE, record)) {
+            out.timestamps.push_back(record.timestamp);
+            out.values.push_back(record.value);
+        } else {
+            out.badLines++;
+        }
+    }
+}
+
+struct ImportOptions {
+    std::string dbPath = "temperature.db";
+    int sensorId = 0;
+    unsigned threads = 0;
+    size_t chunkBytes = 8u << 20;        // 8 МБ на кусок
+    size_t rowsPerTransaction = 1000000;
+};
+
+struct ImportResult {
+    size_t rows = 0;
+    size_t badLines = 0;
+    int64_t minTimestamp = 0;
+    bool ok = true;
+};
+
+static bool exec(sqlite3* db, const char* sql) {
+    char* errMsg = nullptr;
+    if (sqlite3_exec(db, sql, nullptr, nullptr, &errMsg) != SQLITE_OK) {
+        std::cerr << "[Import] SQL error: " << errMsg << "\n";
+        sqlite3_free(errMsg);
+        return false;
+    }
+    return true;
+}
+
+// Загружает один лог в таблицу table (колонка значения — valueColumn)
+static ImportResult importFile(sqlite3* db, const std::string& path, const std::string& table,
+                               const std::string& valueColumn, const ImportOptions& opt) {
+    ImportResult result;
+    std::vector<std::unique_ptr<MappedFile>> files;
+    std::vector<std::pair<const char*, const char*>> chunks;
+
+    // Каталог сегментов: кусок = сегмент, сегменты по имени идут по времени
+    std::error_code ec;
+    const bool segments = std::filesystem::is_directory(path, ec);
+    if (segments) {
+        std::vector<std::string> names;
+        for (const auto& entry : std::filesystem::directory_iterator(path, ec)) {
+            if (entry.path().extension() == ".seg") names.push_back(entry.path().string());
+        }
+        std::sort(names.begin(), names.end());
+        for (const auto& name : names) {
+            files.push_back(std::make_unique<MappedFile>(name));
+            const MappedFile& file = *files.back();
+            if (file.size() > 0) chunks.emplace_back(file.data(), file.data() + file.size());
+        }
+    } else {
+        files.push_back(std::make_unique<MappedFile>(path));
+        const MappedFile& file = *files.back();
+        // Границы кусков сдвигаем на ближайший перевод строки
+        const char* base = file.data();
+        const char* fileEnd = base + file.size();
+        for (const char* p = base; p < fileEnd;) {
+            const char* e = p + opt.chunkBytes < fileEnd ? p + opt.chunkBytes : fileEnd;
+            if (e < fileEnd) {
+                const char* nl = static_cast<const char*>(std::memchr(e, '\n', static_cast<size_t>(fileEnd - e)));
+                e = nl ? nl + 1 : fileEnd;
+            }
+            chunks.emplace_back(p, e);
+            p = e;
+        }
+    }
+    if (chunks.empty()) {
+        std::cout << "[Import] " << path << ": skipped (missing or empty)\n";
+        return result;
+    }
+
+    std::vector<ParsedChunk> parsed(chunks.size());
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::atomic<size_t> nextChunk{0};
+    size_t consumed = 0;  // под mtx: сколько кусков уже записано
+    const size_t window = opt.threads * 2;  // ограничиваем число разобранных, но не записанных кусков
+
+    auto worker = [&]() {
+        while (true) {
+            size_t i = nextChunk++;
+            if (i >= chunks.size()) return;
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                cv.wait(lock, [&] { return i < consumed + window; });
+            }
+            ParsedChunk local;
+            if (segments) {
+                parseSegment(chunks[i].first, chunks[i].second, local);
+            } else {
+                parseChunk(chunks[i].first, chunks[i].second, local);
+            }
+            std::lock_guard<std::mutex> lock(mtx);
+            parsed[i] = std::move(local);
+            parsed[i].ready = true;
+            cv.notify_all();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < opt.threads; ++t) workers.emplace_back(worker);
+
+    std::string sql = "INSERT INTO " + table + " (sensor_id, timestamp, " + valueColumn + ") VALUES (?, ?, ?);";
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+        std::cerr << "[Import] " << sqlite3_errmsg(db) << "\n";
+        result.ok = false;
+    }
+
+    auto started = std::chrono::steady_clock::now();
+    size_t inTransaction = 0;
+    result.ok = result.ok && exec(db, "BEGIN;");
+
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        ParsedChunk chunk;
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            cv.wait(lock, [&] { return parsed[i].ready; });
+            chunk = std::move(parsed[i]);
+        }
+
+        result.badLines += chunk.badLines;
+        for (size_t r = 0; r < chunk.timestamps.size() && result.ok; ++r) {
+            sqlite3_bind_int(stmt, 1, opt.sensorId);
+            sqlite3_bind_int64(stmt, 2, chunk.timestamps[r]);
+            sqlite3_bind_double(stmt, 3, static_cast<double>(chunk.values[r]));
+            if (sqlite3_step(stmt) != SQLITE_DONE) {
+                std::cerr << "[Import] Insert failed: " << sqlite3_errmsg(db) << "\n";
+                result.ok = false;
+            }
+            sqlite3_reset(stmt);
+
+            if (result.rows == 0 || chunk.timestamps[r] < result.minTimestamp) {
+                result.minTimestamp = chunk.timestamps[r];
+            }
+            result.rows++;
+            if (++inTransaction >= opt.rowsPerTransaction) {
+                result.ok = exec(db, "COMMIT;") && exec(db, "BEGIN;");
+                inTransaction = 0;
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            consumed = i + 1;
+            cv.notify_all();
+        }
+
+        if (!result.ok) {
+            // Дорабатываем оставшиеся куски вхолостую, чтобы потоки завершились
+            std::lock_guard<std::mutex> lock(mtx);
+            consumed = chunks.size();
+            nextChunk = chunks.size();
+            cv.notify_all();
+            break;
+        }
+    }
+
+    for (auto& t : workers) t.join();
+    sqlite3_finalize(stmt);
+    if (result.ok) {
+        result.ok = exec(db, "COMMIT;");
+    } else {
+        exec(db, "ROLLBACK;");
+    }
+
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    std::cout << "[Import] " << path << " -> " << table << ": " << result.rows << " rows, "
+              << result.badLines << " bad lines, " << secs << " s";
+    if (secs > 0) std::cout << " (" << static_cast<long long>(result.rows / secs) << " rows/s)";
+    std::cout << "\n";
+    return result;
+}
+
+static void usage(const char* prog) {
+    std::cerr << "Usage: " << prog << " [--db PATH] [--sensor N] [--threads N] [--batch ROWS]\n"
+              << "       [--measurements PATH] [--hourly PATH] [--daily PATH]\n"
+              << "PATH is a Lab4 segment directory or a legacy text log\n";
+}
+
+int main(int argc, char* argv[]) {
+    ImportOptions opt;
+    std::string measurementsFile = "measurements";
+    std::string hourlyFile = "hourly_average";
+    std::string dailyFile = "daily_average";
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+            return 1;
+        }
+        if (arg == "--db") opt.dbPath = argv[++i];
+        else if (arg == "--sensor") opt.sensorId = std::atoi(argv[++i]);
+        else if (arg == "--threads") opt.threads = static_cast<unsigned>(std::atoi(argv[++i]));
+        else if (arg == "--batch") opt.rowsPerTransaction = static_cast<size_t>(std::strtoull(argv[++i], nullptr, 10));
+        else if (arg == "--measurements") measurementsFile = argv[++i];
+        else if (arg == "--hourly") hourlyFile = argv[++i];
+        else if (arg == "--daily") dailyFile = argv[++i];
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (opt.threads == 0) opt.threads = std::thread::hardware_concurrency() ? std::thread::hardware_concurrency() : 4;
+    if (opt.rowsPerTransaction == 0) opt.rowsPerTransaction = 1;
+
+    if (!initDatabase(opt.dbPath.c_str())) return 1;
+
+    sqlite3* db;
+    if (sqlite3_open(opt.dbPath.c_str(), &db) != SQLITE_OK) {
+        std::cerr << "[Import] Cannot open database: " << sqlite3_errmsg(db) << "\n";
+        sqlite3_close(db);
+        return 1;
+    }
+
+    // На время загрузки: без fsync на каждой транзакции, большой кэш страниц
+    exec(db, "PRAGMA synchronous = OFF;");
+    exec(db, "PRAGMA cache_size = -262144;");
+    exec(db, "PRAGMA temp_store = MEMORY;");
+
+    auto started = std::chrono::steady_clock::now();
+    bool ok = dropIndexes(db);
+
+    ImportResult measurements;
+    if (ok) {
+        measurements = importFile(db, measurementsFile, "measurements", "temperature", opt);
+        ok = measurements.ok;
+    }
+    ok = ok && importFile(db, hourlyFile, "hourly_averages", "average", opt).ok;
+    ok = ok && importFile(db, dailyFile, "daily_averages", "average", opt).ok;
+
+    // Индексы и производные таблицы строим один раз по уже загруженным данным
+    auto phase = std::chrono::steady_clock::now();
+    bool indexed = createIndexes(db);
+    std::cout << "[Import] Indexes built in "
+              << std::chrono::duration<double>(std::chrono::steady_clock::now() - phase).count() << " s\n";
+    ok = ok && indexed;
+
+    if (ok && measurements.rows > 0) {
+        phase = std::chrono::steady_clock::now();
+        ok = rebuildAggregateIndex(db) &&
+             rebuildHourlySketches(db, static_cast<time_t>(measurements.minTimestamp));
+        std::cout << "[Import] Rollups built in "
+                  << std::chrono::duration<double>(std::chrono::steady_clock::now() - phase).count() << " s\n";
+    }
+
+    sqlite3_close(db);
+    std::cout << "[Import] " << (ok ? "Done" : "Failed") << " in "
+              << std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count() << " s\n";
+    return ok ? 0 : 1;
+}
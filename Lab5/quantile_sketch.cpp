@@ -0,0 +1,420 @@
+#include "quantile_sketch.h"
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+// Значения по модулю меньше этого считаются нулём
+static const double MIN_INDEXABLE = 1e-9;
+static const unsigned char SKETCH_FORMAT = 1;
+
+QuantileSketch::QuantileSketch(double relativeAccuracy)
+    : alpha_(relativeAccuracy),
+      gamma_((1.0 + relativeAccuracy) / (1.0 - relativeAccuracy)),
+      logGamma_(std::log((1.0 + relativeAccuracy) / (1.0 - relativeAccuracy))) {}
+
+int QuantileSketch::keyOf(double absValue) const {
+    return static_cast<int>(std::ceil(std::log(absValue) / logGamma_));
+}
+
+double QuantileSketch::valueOf(int key) const {
+    return 2.0 * std::pow(gamma_, key) / (gamma_ + 1.0);
+}
+
+void QuantileSketch::add(double value) {
+    if (std::isnan(value)) return;
+    if (count_ == 0 || value < min_) min_ = value;
+    if (count_ == 0 || value > max_) max_ = value;
+    count_++;
+
+    if (value > MIN_INDEXABLE) {
+        positive_[keyOf(value)]++;
+    } else if (value < -MIN_INDEXABLE) {
+        negative_[keyOf(-value)]++;
+    } else {
+        zeroCount_++;
+    }
+}
+
+void QuantileSketch::merge(const QuantileSketch& other) {
+    if (other.count_ == 0) return;
+    if (count_ == 0 || other.min_ < min_) min_ = other.min_;
+    if (count_ == 0 || other.max_ > max_) max_ = other.max_;
+    count_ += other.count_;
+    zeroCount_ += other.zeroCount_;
+    for (const auto& [key, c] : other.positive_) positive_[key] += c;
+    for (const auto& [key, c] : other.negative_) negative_[key] += c;
+}
+
+double QuantileSketch::quantile(double q) const {
+    if (count_ == 0) return 0.0;
+    if (q <= 0.0) return min_;
+    if (q >= 1.0) return max_;
+
+    double rank = q * static_cast<double>(count_ - 1);
+    double result = max_;
+    uint64_t seen = 0;
+    bool found = false;
+
+    // По возрастанию значений: сначала отрицательные (от больших по модулю), потом нули, потом положительные
+    for (auto it = negative_.rbegin(); it != negative_.rend() && !found; ++it) {
+        seen += it->second;
+        if (static_cast<double>(seen) > rank) {
+            result = -valueOf(it->first);
+            found = true;
+        }
+    }
+    if (!found) {
+        seen += zeroCount_;
+        if (static_cast<double>(seen) > rank) {
+            result = 0.0;
+            found = true;
+        }
+    }
+    for (auto it = positive_.begin(); it != positive_.end() && !found; ++it) {
+        seen += it->second;
+        if (static_cast<double>(seen) > rank) {
+            result = valueOf(it->first);
+            found = true;
+        }
+    }
+
+    if (result < min_) result = min_;
+    if (result > max_) result = max_;
+    return result;
+}
+
+// SERIALIZATION
+// [формат][alpha][min][max][zeroCount]
+// [число корзин +][(ключ zigzag, счётчик) ...][число корзин -][...] — целые как varint
+
+static void putVarint(std::string& out, uint64_t v) {
+    while (v >= 0x80) {
+        out += static_cast<char>((v & 0x7F) | 0x80);
+        v >>= 7;
+    }
+    out += static_cast<char>(v);
+}
+
+static bool getVarint(const unsigned char*& p, const unsigned char* end, uint64_t& v) {
+    v = 0;
+    for (int shift = 0; shift < 64 && p < end; shift += 7) {
+        unsigned char b = *p++;
+        v |= static_cast<uint64_t>(b & 0x7F) << shift;
+        if (!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+static void putDouble(std::string& out, double d) {
+    char buf[sizeof(double)];
+    std::memcpy(buf, &d, sizeof(d));
+    out.append(buf, sizeof(buf));
+}
+
+static bool getDouble(const unsigned char*& p, const unsigned char* end, double& d) {
+    if (end - p < static_cast<std::ptrdiff_t>(sizeof(double))) return false;
+    std::memcpy(&d, p, sizeof(d));
+    p += sizeof(d);
+    return true;
+}
+
+static void putStore(std::string& out, const std::map<int, uint64_t>& store) {
+    putVarint(out, store.size());
+    for (const auto& [key, c] : store) {
+        uint64_t zigzag = (static_cast<uint64_t>(key) << 1) ^ static_cast<uint64_t>(key >> 31);
+        putVarint(out, zigzag);
+        putVarint(out, c);
+    }
+}
+
+static bool getStore(const unsigned char*& p, const unsigned char* end, std::map<int, uint64_t>& store, uint64_t& total) {
+    uint64_t n;
+    if (!getVarint(p, end, n)) return false;
+    for (uint64_t i = 0; i < n; ++i) {
+        uint64_t zigzag, c;
+        if (!getVarint(p, end, zigzag) || !getVarint(p, end, c)) return false;
+        int key = static_cast<int>((zigzag >> 1) ^ (~(zigzag & 1) + 1));
+        store[key] += c;
+        total += c;
+    }
+    return true;
+}
+
+std::string QuantileSketch::serialize() const {
+    std::string out;
+    out += static_cast<char>(SKETCH_FORMAT);
+    putDouble(out, alpha_);
+    putDouble(out, min_);
+    putDouble(out, max_);
+    putVarint(out, zeroCount_);
+    putStore(out, positive_);
+    putStore(out, negative_);
+    return out;
+}
+
+bool QuantileSketch::deserialize(const void* data, size_t size, QuantileSketch& out) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    const unsigned char* end = p + size;
+    if (size == 0 || *p++ != SKETCH_FORMAT) return false;
+
+    double alpha, mn, mx;
+    if (!getDouble(p, end, alpha) || !(alpha > 0.0 && alpha < 1.0)) return false;
+    QuantileSketch sketch(alpha);
+    if (!getDouble(p, end, mn) || !getDouble(p, end, mx)) return false;
+    if (!getVarint(p, end, sketch.zeroCount_)) return false;
+
+    uint64_t total = sketch.zeroCount_;
+    if (!getStore(p, end, sketch.positive_, total)) return false;
+    if (!getStore(p, end, sketch.negative_, total)) return false;
+    sketch.count_ = total;
+    sketch.min_ = mn;
+    sketch.max_ = mx;
+    out = std::move(sketch);
+    return true;
+}
+
+// HOURLY STORE
+
+static long long hourStart(time_t ts) {
+    long long t = static_cast<long long>(ts);
+    long long q = t / SKETCH_HOUR;
+    if (t % SKETCH_HOUR != 0 && t < 0) q--;
+    return q * SKETCH_HOUR;
+}
+
+static bool loadSketch(sqlite3* db, int sensorId, long long hour, QuantileSketch& out) {
+    const char* sql = "SELECT sketch FROM hourly_sketches WHERE sensor_id = ? AND hour_start = ?;";
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) return false;
+    sqlite3_bind_int(stmt, 1, sensorId);
+    sqlite3_bind_int64(stmt, 2, hour);
+    bool ok = false;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        ok = QuantileSketch::deserialize(sqlite3_column_blob(stmt, 0),
+                                         static_cast<size_t>(sqlite3_column_bytes(stmt, 0)), out);
+    }
+    sqlite3_finalize(stmt);
+    return ok;
+}
+
+static bool saveSketch(sqlite3_stmt* stmt, int sensorId, long long hour, const QuantileSketch& sketch) {
+    std::string blob = sketch.serialize();
+    sqlite3_bind_int(stmt, 1, sensorId);
+    sqlite3_bind_int64(stmt, 2, hour);
+    sqlite3_bind_int64(stmt, 3, static_cast<sqlite3_int64>(sketch.count()));
+    sqlite3_bind_blob(stmt, 4, blob.data(), static_cast<int>(blob.size()), SQLITE_TRANSIENT);
+    bool ok = sqlite3_step(stmt) == SQLITE_DONE;
+    sqlite3_reset(stmt);
+    return ok;
+}
+
+static const char* UPSERT_SKETCH =
+    "INSERT OR REPLACE INTO hourly_sketches (sensor_id, hour_start, count, sketch) VALUES (?, ?, ?, ?);";
+
+void HourlySketchStore::add(sqlite3* db, int sensorId, time_t ts, double value) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    Key key{sensorId, hourStart(ts)};
+    auto it = staged_.find(key);
+    if (it == staged_.end()) {
+        // Час мог быть начат до перезапуска или уже выгружен — продолжаем сохранённый скетч
+        QuantileSketch sketch;
+        auto current = open_.find(key);
+        if (current != open_.end()) sketch = current->second;
+        else loadSketch(db, sensorId, key.second, sketch);
+        it = staged_.emplace(key, std::move(sketch)).first;
+    }
+    it->second.add(value);
+}
+
+bool HourlySketchStore::save(sqlite3* db) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (staged_.empty()) return true;
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, UPSERT_SKETCH, -1, &stmt, nullptr) != SQLITE_OK) return false;
+    bool ok = true;
+    for (auto it = staged_.begin(); ok && it != staged_.end(); ++it) {
+        ok = saveSketch(stmt, it->first.first, it->first.second, it->second);
+    }
+    sqlite3_finalize(stmt);
+    return ok;
+}
+
+void HourlySketchStore::commit(time_t now) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    for (auto& entry : staged_) open_[entry.first] = std::move(entry.second);
+    staged_.clear();
+
+    // В памяти держим только текущий и предыдущий час
+    long long keepFrom = hourStart(now) - SKETCH_HOUR;
+    for (auto it = open_.begin(); it != open_.end();) {
+        if (it->first.second < keepFrom) it = open_.erase(it);
+        else ++it;
+    }
+}
+
+void HourlySketchStore::rollback() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    staged_.clear();
+}
+
+// Добавляет в out сырые измерения из [from, to]
+static bool addRawRange(sqlite3* db, int sensorId, long long from, long long to, QuantileSketch& out) {
+    if (to < from) return true;
+    const char* sql = "SELECT temperature FROM measurements WHERE sensor_id = ? AND timestamp BETWEEN ? AND ?;";
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) return false;
+    sqlite3_bind_int(stmt, 1, sensorId);
+    sqlite3_bind_int64(stmt, 2, from);
+    sqlite3_bind_int64(stmt, 3, to);
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        out.add(sqlite3_column_double(stmt, 0));
+    }
+    sqlite3_finalize(stmt);
+    return rc == SQLITE_DONE;
+}
+
+bool HourlySketchStore::query(sqlite3* db, int sensorId, time_t start, time_t end, QuantileSketch& out) {
+    out = QuantileSketch();
+    if (end < start) return true;
+
+    long long s = start, e = end;
+    long long firstHour = hourStart(start);
+    if (firstHour < s) firstHour += SKETCH_HOUR;
+    long long lastHourEnd = hourStart(end) + SKETCH_HOUR - 1;
+    if (lastHourEnd > e) lastHourEnd -= SKETCH_HOUR;
+
+    if (lastHourEnd < firstHour) {
+        // Целых часов в диапазоне нет
+        return addRawRange(db, sensorId, s, e, out);
+    }
+
+    bool ok = addRawRange(db, sensorId, s, firstHour - 1, out);
+    ok = addRawRange(db, sensorId, lastHourEnd + 1, e, out) && ok;
+
+    std::lock_guard<std::mutex> lock(mtx_);
+    const char* sql = "SELECT hour_start, sketch FROM hourly_sketches WHERE sensor_id = ? AND hour_start BETWEEN ? AND ?;";
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) return false;
+    sqlite3_bind_int(stmt, 1, sensorId);
+    sqlite3_bind_int64(stmt, 2, firstHour);
+    sqlite3_bind_int64(stmt, 3, lastHourEnd - SKETCH_HOUR + 1);
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        Key key{sensorId, sqlite3_column_int64(stmt, 0)};
+        if (open_.count(key)) continue;  // в памяти версия свежее
+        QuantileSketch sketch;
+        if (QuantileSketch::deserialize(sqlite3_column_blob(stmt, 1),
+                                        static_cast<size_t>(sqlite3_column_bytes(stmt, 1)), sketch)) {
+            out.merge(sketch);
+        }
+    }
+    sqlite3_finalize(stmt);
+
+    for (auto it = open_.lower_bound(Key{sensorId, firstHour});
+         it != open_.end() && it->first.first == sensorId && it->first.second <= lastHourEnd; ++it) {
+        out.merge(it->second);
+    }
+    return ok;
+}
+
+bool rebuildHourlySketches(sqlite3* db, time_t fromTs) {
+    long long from = hourStart(fromTs);
+    if (sqlite3_exec(db, "BEGIN;", nullptr, nullptr, nullptr) != SQLITE_OK) return false;
+
+    sqlite3_stmt* del;
+    sqlite3_stmt* rows;
+    sqlite3_stmt* ins;
+    const char* delSql = "DELETE FROM hourly_sketches WHERE hour_start >= ?;";
+    const char* rowsSql = "SELECT sensor_id, timestamp, temperature FROM measurements "
+                          "WHERE timestamp >= ? ORDER BY sensor_id, timestamp;";
+    if (sqlite3_prepare_v2(db, delSql, -1, &del, nullptr) != SQLITE_OK) {
+        sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+        return false;
+    }
+    sqlite3_bind_int64(del, 1, from);
+    bool ok = sqlite3_step(del) == SQLITE_DONE;
+    sqlite3_finalize(del);
+
+    if (!ok || sqlite3_prepare_v2(db, rowsSql, -1, &rows, nullptr) != SQLITE_OK) {
+        sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+        return false;
+    }
+    if (sqlite3_prepare_v2(db, UPSERT_SKETCH, -1, &ins, nullptr) != SQLITE_OK) {
+        sqlite3_finalize(rows);
+        sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+        return false;
+    }
+    sqlite3_bind_int64(rows, 1, from);
+
+    // Строки идут по (датчик, время), поэтому каждый часовой скетч собирается подряд
+    int curSensor = 0;
+    long long curHour = 0;
+    bool haveCurrent = false;
+    QuantileSketch sketch;
+    size_t hours = 0;
+    int rc;
+    while (ok && (rc = sqlite3_step(rows)) == SQLITE_ROW) {
+        int sensorId = sqlite3_column_int(rows, 0);
+        long long hour = hourStart(static_cast<time_t>(sqlite3_column_int64(rows, 1)));
+        if (haveCurrent && (sensorId != curSensor || hour != curHour)) {
+            ok = saveSketch(ins, curSensor, curHour, sketch);
+            sketch = QuantileSketch();
+            hours++;
+        }
+        curSensor = sensorId;
+        curHour = hour;
+        haveCurrent = true;
+        sketch.add(sqlite3_column_double(rows, 2));
+    }
+    if (ok && haveCurrent) {
+        ok = saveSketch(ins, curSensor, curHour, sketch);
+        hours++;
+    }
+    sqlite3_finalize(rows);
+    sqlite3_finalize(ins);
+
+    if (!ok || sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+        std::cerr << "[DB] Error rebuilding hourly_sketches: " << sqlite3_errmsg(db) << "\n";
+        sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+        return false;
+    }
+    std::cout << "[DB] Rebuilt " << hours << " hourly sketches\n";
+    return true;
+}
+
+bool initHourlySketches(sqlite3* db) {
+    const char* sql = R"(
+        CREATE TABLE IF NOT EXISTS hourly_sketches (
+            sensor_id INTEGER NOT NULL,
+            hour_start INTEGER NOT NULL,
+            count INTEGER NOT NULL,
+            sketch BLOB NOT NULL,
+            PRIMARY KEY (sensor_id, hour_start)
+        ) WITHOUT ROWID;
+    )";
+    char* errMsg = nullptr;
+    if (sqlite3_exec(db, sql, nullptr, nullptr, &errMsg) != SQLITE_OK) {
+        std::cerr << "[DB] Error creating hourly_sketches: " << errMsg << "\n";
+        sqlite3_free(errMsg);
+        return false;
+    }
+
+    // Сервер пишет скетчи вместе с измерениями, но импорт и базы прежних версий
+    // могли оставить последний сохранённый час неполным, а после него скетчей нет вовсе
+    const char* check = "SELECT (SELECT MAX(hour_start) FROM hourly_sketches), (SELECT MIN(timestamp) FROM measurements);";
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, check, -1, &stmt, nullptr) != SQLITE_OK) return false;
+    bool haveSketches = false, haveRows = false;
+    time_t lastHour = 0, firstRow = 0;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        haveSketches = sqlite3_column_type(stmt, 0) != SQLITE_NULL;
+        haveRows = sqlite3_column_type(stmt, 1) != SQLITE_NULL;
+        lastHour = static_cast<time_t>(sqlite3_column_int64(stmt, 0));
+        firstRow = static_cast<time_t>(sqlite3_column_int64(stmt, 1));
+    }
+    sqlite3_finalize(stmt);
+
+    if (!haveRows) return true;
+    return rebuildHourlySketches(db, haveSketches ? lastHour : firstRow);
+}
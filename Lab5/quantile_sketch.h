@@ -0,0 +1,89 @@
+#ifndef QUANTILE_SKETCH_H
+#define QUANTILE_SKETCH_H
+
+#include <cstdint>
+#include <cstddef>
+#include <ctime>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <sqlite3.h>
+
+// DDSketch: квантили с гарантированной относительной погрешностью.
+// Значение v попадает в корзину ceil(log_gamma(|v|)), отрицательные и нули
+// хранятся отдельно. Скетчи складываются (merge) без потери точности,
+// поэтому часовые скетчи можно объединять в любой период.
+class QuantileSketch {
+public:
+    explicit QuantileSketch(double relativeAccuracy = 0.005);
+
+    void add(double value);
+    void merge(const QuantileSketch& other);
+
+    // q в [0, 1]; для пустого скетча возвращает 0
+    double quantile(double q) const;
+    uint64_t count() const { return count_; }
+    bool empty() const { return count_ == 0; }
+
+    std::string serialize() const;
+    static bool deserialize(const void* data, size_t size, QuantileSketch& out);
+
+private:
+    int keyOf(double absValue) const;
+    double valueOf(int key) const;
+
+    double alpha_;
+    double gamma_;
+    double logGamma_;
+    std::map<int, uint64_t> positive_;
+    std::map<int, uint64_t> negative_;   // ключи по модулю значения
+    uint64_t zeroCount_ = 0;
+    uint64_t count_ = 0;
+    double min_ = 0.0;
+    double max_ = 0.0;
+};
+
+// Часовые скетчи (таблица hourly_sketches). Скетчи текущего и прошлого часа
+// живут в памяти; изменённые пачкой измерений записываются в БД в той же
+// транзакции, что и сами измерения, так что скетчи не отстают от measurements
+// ни после сбоя, ни для опоздавших значений за давно прошедший час.
+const time_t SKETCH_HOUR = 3600;
+
+class HourlySketchStore {
+public:
+    HourlySketchStore() = default;
+    HourlySketchStore(const HourlySketchStore&) = delete;
+    HourlySketchStore& operator=(const HourlySketchStore&) = delete;
+
+    // Учитывает измерение в черновике пачки; db — соединение пишущего потока,
+    // в нём уже открыта транзакция с измерениями
+    void add(sqlite3* db, int sensorId, time_t ts, double value);
+
+    // Записывает скетчи, затронутые пачкой, в той же транзакции
+    bool save(sqlite3* db);
+
+    // После COMMIT: черновик становится текущим состоянием, прошедшие часы
+    // выгружаются из памяти. После ROLLBACK — rollback(), и пачку можно повторить
+    void commit(time_t now);
+    void rollback();
+
+    // Скетч за [start, end]: целые часы берутся готовыми, края — по сырым строкам
+    bool query(sqlite3* db, int sensorId, time_t start, time_t end, QuantileSketch& out);
+
+private:
+    using Key = std::pair<int, long long>;  // (sensor_id, начало часа)
+
+    std::mutex mtx_;
+    std::map<Key, QuantileSketch> open_;
+    std::map<Key, QuantileSketch> staged_;   // копии, изменённые текущей пачкой
+};
+
+// Создаёт таблицу и досчитывает скетчи, которые не успели попасть в БД:
+// все часы, начиная с последнего сохранённого (или вообще все, если таблица пуста)
+bool initHourlySketches(sqlite3* db);
+
+// Пересчитывает скетчи всех часов, начиная с fromTs, по таблице measurements
+bool rebuildHourlySketches(sqlite3* db, time_t fromTs);
+
+#endif // QUANTILE_SKETCH_H
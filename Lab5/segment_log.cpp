@@ -0,0 +1,430 @@
+#include "segment_log.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <utility>
+
+#include <chrono>
+#include <fcntl.h>
+
+#ifdef _WIN32
+    #include <windows.h>
+    #include <io.h>
+    #define seg_open(path) _open(path, _O_WRONLY | _O_APPEND | _O_CREAT | _O_BINARY, 0644)
+    #define seg_create(path) _open(path, _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, 0644)
+    #define seg_write(fd, data, size) _write(fd, data, static_cast<unsigned>(size))
+    #define seg_sync _commit
+    #define seg_close _close
+#else
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+    #define seg_open(path) open(path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644)
+    #define seg_create(path) open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)
+    #define seg_write write
+    #ifdef __APPLE__
+        #define seg_sync fsync
+    #else
+        #define seg_sync fdatasync
+    #endif
+    #define seg_close close
+#endif
+
+namespace fs = std::filesystem;
+
+static uint32_t crc32(const unsigned char* data, size_t size) {
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> t{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[i] = c;
+        }
+        return t;
+    }();
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; ++i) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return crc ^ 0xFFFFFFFFu;
+}
+
+void encodeLogRecord(int64_t ts, float value, unsigned char* out) {
+    std::memcpy(out, &ts, 8);
+    std::memcpy(out + 8, &value, 4);
+    uint32_t crc = crc32(out, 12);
+    std::memcpy(out + 12, &crc, 4);
+}
+
+bool decodeLogRecord(const unsigned char* in, LogRecord& record) {
+    uint32_t crc;
+    std::memcpy(&crc, in + 12, 4);
+    if (crc != crc32(in, 12)) return false;
+    std::memcpy(&record.timestamp, in, 8);
+    std::memcpy(&record.value, in + 8, 4);
+    return true;
+}
+
+// Сегмент, отображённый в память только для чтения
+class MappedSegment {
+public:
+    explicit MappedSegment(const std::string& path) {
+#ifdef _WIN32
+        file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                            nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file_ == INVALID_HANDLE_VALUE) return;
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file_, &size) || size.QuadPart == 0) return;
+        size_ = static_cast<size_t>(size.QuadPart);
+        mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping_) return;
+        data_ = static_cast<const unsigned char*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+#else
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) {
+            close(fd);
+            return;
+        }
+        size_ = static_cast<size_t>(st.st_size);
+        void* p = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (p == MAP_FAILED) return;
+        data_ = static_cast<const unsigned char*>(p);
+#endif
+    }
+
+    ~MappedSegment() {
+#ifdef _WIN32
+        if (data_) UnmapViewOfFile(data_);
+        if (mapping_) CloseHandle(mapping_);
+        if (file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+#else
+        if (data_) munmap(const_cast<unsigned char*>(data_), size_);
+#endif
+    }
+
+    MappedSegment(const MappedSegment&) = delete;
+    MappedSegment& operator=(const MappedSegment&) = delete;
+
+    const unsigned char* data() const { return data_; }
+    size_t size() const { return data_ ? size_ : 0; }
+
+private:
+    const unsigned char* data_ = nullptr;
+    size_t size_ = 0;
+#ifdef _WIN32
+    HANDLE file_ = INVALID_HANDLE_VALUE;
+    HANDLE mapping_ = nullptr;
+#endif
+};
+
+// Пишет весь буфер, повторяя write при частичной записи
+static bool writeAll(int fd, const unsigned char* data, size_t size) {
+    size_t done = 0;
+    while (done < size) {
+        auto n = seg_write(fd, data + done, size - done);
+        if (n <= 0) return false;
+        done += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// После rename сама запись каталога тоже должна попасть на диск
+static void syncDirectory(const std::string& directory) {
+#ifndef _WIN32
+    int fd = open(directory.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return;
+    fsync(fd);
+    close(fd);
+#else
+    (void)directory;
+#endif
+}
+
+SegmentLog::SegmentLog(std::string directory, time_t partitionSeconds, CutoffFn retentionCutoff,
+                       SyncPolicy policy, int syncIntervalMs)
+    : directory_(std::move(directory)), partitionSeconds_(partitionSeconds), cutoff_(std::move(retentionCutoff)),
+      policy_(policy), syncIntervalMs_(syncIntervalMs),
+      queue_(std::make_unique<SpscRing<LogRecord, LOG_QUEUE_CAPACITY>>()) {
+    std::error_code ec;
+    fs::create_directories(directory_, ec);
+    if (ec) std::cerr << "Cannot create " << directory_ << ": " << ec.message() << "\n";
+    buffer_.reserve(LOG_QUEUE_CAPACITY * LOG_RECORD_SIZE);
+    writer_ = std::thread(&SegmentLog::writerLoop, this);
+    compactor_ = std::thread(&SegmentLog::compactorLoop, this);
+}
+
+SegmentLog::~SegmentLog() {
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    if (writer_.joinable()) writer_.join();
+    {
+        std::lock_guard<std::mutex> lock(compactMtx_);
+        compactStop_ = true;
+    }
+    compactCv_.notify_all();
+    if (compactor_.joinable()) compactor_.join();
+}
+
+std::string SegmentLog::segmentPath(time_t partition) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%020lld.seg", static_cast<long long>(partition));
+    return (fs::path(directory_) / name).string();
+}
+
+std::vector<time_t> SegmentLog::listSegments() const {
+    std::vector<time_t> partitions;
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(directory_, ec)) {
+        std::string name = entry.path().filename().string();
+        if (name.size() != 24 || name.compare(20, 4, ".seg") != 0) continue;
+        partitions.push_back(static_cast<time_t>(std::strtoll(name.c_str(), nullptr, 10)));
+    }
+    std::sort(partitions.begin(), partitions.end());
+    return partitions;
+}
+
+void SegmentLog::closeSegment() {
+    std::lock_guard<std::mutex> lock(segmentMtx_);
+    closeSegmentLocked();
+}
+
+void SegmentLog::closeSegmentLocked() {
+    if (fd_ < 0) return;
+    if (dirty_ && policy_ != SyncPolicy::Never) seg_sync(fd_);
+    seg_close(fd_);
+    fd_ = -1;
+    dirty_ = false;
+    activePartition_ = -1;
+}
+
+bool SegmentLog::openSegment(time_t partition) {
+    {
+        std::lock_guard<std::mutex> lock(segmentMtx_);
+        closeSegmentLocked();
+
+        std::string path = segmentPath(partition);
+        // Хвост, недописанный при падении, отрезаем до целой записи
+        std::error_code ec;
+        uintmax_t size = fs::file_size(path, ec);
+        if (!ec && size % LOG_RECORD_SIZE != 0) fs::resize_file(path, size - size % LOG_RECORD_SIZE, ec);
+
+        fd_ = seg_open(path.c_str());
+        if (fd_ < 0) {
+            std::cerr << "Cannot open " << path << "\n";
+            return false;
+        }
+        activePartition_ = partition;
+    }
+
+    // Новый сегмент — повод проверить срок хранения; делает это поток уплотнения
+    if (partition > newestPartition_.load()) {
+        newestPartition_ = partition;
+        std::lock_guard<std::mutex> lock(compactMtx_);
+        compactCv_.notify_one();
+    }
+    return true;
+}
+
+void SegmentLog::append(time_t ts, float value) {
+    auto fill = [&](LogRecord& slot) {
+        slot.timestamp = static_cast<int64_t>(ts);
+        slot.value = value;
+    };
+    if (!queue_->tryPush(fill)) {
+        // Писатель не успевает (диск занят): ждём его, а не теряем запись
+        stalls_++;
+        cv_.notify_one();
+        while (!queue_->tryPush(fill)) std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    queued_++;
+
+    // Барьер в паре с проверкой очереди в writerLoop: либо мы увидим, что
+    // писатель уснул, либо он увидит нашу запись
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (idle_.load()) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        cv_.notify_one();
+    }
+}
+
+void SegmentLog::flush() {
+    std::unique_lock<std::mutex> lock(mtx_);
+    cv_.notify_one();
+    flushed_.wait(lock, [&] { return written_.load() >= queued_; });
+}
+
+void SegmentLog::writeBatch(const std::vector<LogRecord>& batch) {
+    // Подряд идущие записи одного сегмента кодируем в один буфер и пишем одним write
+    size_t i = 0;
+    while (i < batch.size()) {
+        time_t partition = static_cast<time_t>(batch[i].timestamp) - static_cast<time_t>(batch[i].timestamp) % partitionSeconds_;
+        size_t j = i;
+        buffer_.clear();
+        while (j < batch.size()) {
+            time_t ts = static_cast<time_t>(batch[j].timestamp);
+            if (ts - ts % partitionSeconds_ != partition) break;
+            size_t offset = buffer_.size();
+            buffer_.resize(offset + LOG_RECORD_SIZE);
+            encodeLogRecord(batch[j].timestamp, batch[j].value, buffer_.data() + offset);
+            ++j;
+        }
+
+        bool ok = partition == activePartition_ || openSegment(partition);
+        if (ok) ok = writeAll(fd_, buffer_.data(), buffer_.size());
+        if (ok) {
+            dirty_ = true;
+        } else {
+            writeErrors_ += j - i;
+            std::cerr << "Cannot write to " << directory_ << ", " << (j - i) << " record(s) lost\n";
+            // Недописанную запись отрежет openSegment при следующем открытии
+            closeSegment();
+        }
+        i = j;
+    }
+}
+
+void SegmentLog::syncSegment() {
+    if (fd_ >= 0 && dirty_) {
+        seg_sync(fd_);
+        dirty_ = false;
+    }
+}
+
+void SegmentLog::writerLoop() {
+    std::vector<LogRecord> batch;
+    batch.reserve(LOG_QUEUE_CAPACITY);
+    auto lastSync = std::chrono::steady_clock::now();
+
+    while (true) {
+        batch.clear();
+        queue_->consumeBatch([&](const LogRecord& r) { batch.push_back(r); });
+        if (!batch.empty()) {
+            writeBatch(batch);
+            if (policy_ == SyncPolicy::EveryBatch) syncSegment();
+            {
+                std::lock_guard<std::mutex> lock(mtx_);
+                written_ += batch.size();
+            }
+            flushed_.notify_all();
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (policy_ == SyncPolicy::Interval && now - lastSync >= std::chrono::milliseconds(syncIntervalMs_)) {
+            syncSegment();
+            lastSync = now;
+        }
+        if (!batch.empty()) continue;
+
+        std::unique_lock<std::mutex> lock(mtx_);
+        if (stop_ && queue_->empty()) break;
+        idle_ = true;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        // Таймаут — чтобы fdatasync по интервалу случался и без новых записей
+        if (queue_->empty()) cv_.wait_for(lock, std::chrono::milliseconds(dirty_ ? syncIntervalMs_ : 1000));
+        idle_ = false;
+    }
+    closeSegment();
+}
+
+void SegmentLog::compactorLoop() {
+    // Временные файлы от уплотнения, прерванного падением: сегмент под ними цел
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(directory_, ec)) {
+        std::string name = entry.path().filename().string();
+        if (name.size() > 8 && name.compare(name.size() - 8, 8, ".seg.tmp") == 0) {
+            std::error_code removeEc;
+            fs::remove(entry.path(), removeEc);
+        }
+    }
+
+    std::unique_lock<std::mutex> lock(compactMtx_);
+    while (true) {
+        compactCv_.wait(lock, [&] { return compactStop_ || newestPartition_.load() != compactedFor_; });
+        if (compactStop_) break;
+        time_t now = newestPartition_.load();
+        lock.unlock();
+        compact(now);
+        lock.lock();
+        compactedFor_ = now;
+    }
+}
+
+void SegmentLog::compact(time_t now) {
+    time_t cutoff = cutoff_(now);
+    for (time_t partition : listSegments()) {
+        if (partition >= cutoff) break;
+
+        std::lock_guard<std::mutex> lock(segmentMtx_);
+        if (partition == activePartition_) continue;
+        if (partition + partitionSeconds_ <= cutoff) {
+            // Весь сегмент устарел
+            std::error_code ec;
+            if (fs::remove(segmentPath(partition), ec)) removed_++;
+        } else if (rewriteSegment(partition, cutoff)) {
+            rewritten_++;
+        }
+    }
+}
+
+bool SegmentLog::rewriteSegment(time_t partition, time_t cutoff) {
+    std::string path = segmentPath(partition);
+    std::vector<unsigned char> kept;
+    size_t total = 0;
+    {
+        MappedSegment segment(path);
+        total = segment.size();
+        LogRecord record;
+        for (size_t offset = 0; offset + LOG_RECORD_SIZE <= total; offset += LOG_RECORD_SIZE) {
+            const unsigned char* raw = segment.data() + offset;
+            if (!decodeLogRecord(raw, record) || record.timestamp < cutoff) continue;
+            kept.insert(kept.end(), raw, raw + LOG_RECORD_SIZE);
+        }
+    }
+    if (kept.size() == total) return false;
+
+    std::error_code ec;
+    if (kept.empty()) {
+        fs::remove(path, ec);
+        return !ec;
+    }
+
+    std::string tmp = path + ".tmp";
+    int fd = seg_create(tmp.c_str());
+    if (fd < 0) {
+        std::cerr << "Cannot create " << tmp << "\n";
+        return false;
+    }
+    bool ok = writeAll(fd, kept.data(), kept.size()) && seg_sync(fd) == 0;
+    seg_close(fd);
+    if (ok) fs::rename(tmp, path, ec);
+    if (!ok || ec) {
+        std::cerr << "Cannot compact " << path << "\n";
+        fs::remove(tmp, ec);
+        return false;
+    }
+    syncDirectory(directory_);
+    return true;
+}
+
+size_t SegmentLog::read(time_t from, time_t to, std::vector<LogRecord>& out) const {
+    size_t added = 0;
+    for (time_t partition : listSegments()) {
+        if (partition + partitionSeconds_ <= from || partition > to) continue;
+        MappedSegment segment(segmentPath(partition));
+        size_t count = segment.size() / LOG_RECORD_SIZE;
+        LogRecord record;
+        for (size_t i = 0; i < count; ++i) {
+            if (!decodeLogRecord(segment.data() + i * LOG_RECORD_SIZE, record)) continue;
+            if (record.timestamp < from || record.timestamp > to) continue;
+            out.push_back(record);
+            added++;
+        }
+    }
+    return added;
+}
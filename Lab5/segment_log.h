@@ -0,0 +1,137 @@
+#ifndef SEGMENT_LOG_H
+#define SEGMENT_LOG_H
+
+#include "spsc_ring.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Одна запись журнала на диске — 16 байт: timestamp i64 | value f32 | crc32 u32.
+// CRC считается по первым 12 байтам; запись с неверной CRC (недописанный хвост)
+// при чтении пропускается
+struct LogRecord {
+    int64_t timestamp = 0;
+    float value = 0.0f;
+};
+
+const size_t LOG_RECORD_SIZE = 16;
+
+// Когда фоновый писатель сбрасывает данные на диск (fdatasync):
+// Never — оставляет это ОС, Interval — не реже раза в syncIntervalMs,
+// EveryBatch — после каждой записанной пачки
+enum class SyncPolicy { Never, Interval, EveryBatch };
+
+// Очередь между append и фоновым писателем
+const size_t LOG_QUEUE_CAPACITY = 8192;
+
+// Журнал из сегментов по времени: каталог/<начало интервала>.seg, в каждом —
+// записи одного интервала длиной partitionSeconds. Новые записи только
+// дописываются в активный сегмент. Чтение идёт через mmap.
+//
+// append только кладёт запись в очередь без блокировок; файлы открывает и
+// пишет фоновый поток: всё накопившееся за раз уходит одним write на сегмент,
+// дескриптор активного сегмента остаётся открытым.
+//
+// Срок хранения соблюдает второй фоновый поток — уплотнение. При переходе в
+// новый сегмент он удаляет сегменты, целиком лежащие раньше retentionCutoff(now),
+// а сегмент, который граница режет посередине, переписывает без устаревших и
+// битых записей: во временный файл, fsync и rename поверх старого, так что при
+// падении остаётся либо старый сегмент, либо новый. Активный сегмент не
+// трогается никогда — запись продолжается в него, пока идёт уплотнение
+class SegmentLog {
+public:
+    // retentionCutoff(now) — самое старое время, которое ещё нужно хранить
+    using CutoffFn = std::function<time_t(time_t now)>;
+
+    SegmentLog(std::string directory, time_t partitionSeconds, CutoffFn retentionCutoff,
+               SyncPolicy policy = SyncPolicy::Interval, int syncIntervalMs = 1000);
+    // Дописывает всё, что осталось в очереди, и сбрасывает на диск
+    ~SegmentLog();
+
+    SegmentLog(const SegmentLog&) = delete;
+    SegmentLog& operator=(const SegmentLog&) = delete;
+
+    // Ставит запись в очередь. Если писатель отстал на всю очередь, ждёт его
+    // (такие случаи считаются в stalls()), но записи не теряет
+    void append(time_t ts, float value);
+
+    // Ждёт, пока всё поставленное в очередь окажется в файлах
+    void flush();
+
+    // Добавляет в out записи с from <= timestamp <= to в порядке сегментов
+    size_t read(time_t from, time_t to, std::vector<LogRecord>& out) const;
+
+    const std::string& directory() const { return directory_; }
+    uint64_t stalls() const { return stalls_; }
+    uint64_t writeErrors() const { return writeErrors_; }
+    // Сколько сегментов удалено по сроку хранения и сколько переписано уплотнением
+    uint64_t segmentsRemoved() const { return removed_; }
+    uint64_t segmentsRewritten() const { return rewritten_; }
+
+private:
+    std::string segmentPath(time_t partition) const;
+    std::vector<time_t> listSegments() const;
+    // Поток писателя
+    bool openSegment(time_t partition);
+    void closeSegment();
+    void closeSegmentLocked();
+    void writeBatch(const std::vector<LogRecord>& batch);
+    void syncSegment();
+    void writerLoop();
+    // Поток уплотнения
+    void compactorLoop();
+    void compact(time_t now);
+    bool rewriteSegment(time_t partition, time_t cutoff);
+
+    std::string directory_;
+    time_t partitionSeconds_;
+    CutoffFn cutoff_;
+    SyncPolicy policy_;
+    int syncIntervalMs_;
+
+    // fd_ и activePartition_ меняет только писатель и только под segmentMtx_;
+    // уплотнение держит его, пока переписывает сегмент, чтобы писатель не открыл
+    // тот же сегмент (опоздавшей записью) и его запись не пропала при rename
+    std::mutex segmentMtx_;
+    int fd_ = -1;
+    time_t activePartition_ = -1;
+    bool dirty_ = false;             // записано после последнего fdatasync
+    std::vector<unsigned char> buffer_;
+
+    std::unique_ptr<SpscRing<LogRecord, LOG_QUEUE_CAPACITY>> queue_;
+    uint64_t queued_ = 0;            // сколько поставлено (только append)
+    std::atomic<uint64_t> written_{0};
+    std::atomic<uint64_t> stalls_{0};
+    std::atomic<uint64_t> writeErrors_{0};
+
+    // Писатель спит, пока очередь пуста; append будит его, если он спит
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    std::condition_variable flushed_;
+    std::atomic<bool> idle_{false};
+    bool stop_ = false;
+    std::thread writer_;
+
+    // Уплотнение запускается, когда писатель открывает сегмент новее прежних
+    std::mutex compactMtx_;
+    std::condition_variable compactCv_;
+    std::atomic<time_t> newestPartition_{-1};
+    time_t compactedFor_ = -1;
+    bool compactStop_ = false;
+    std::atomic<uint64_t> removed_{0};
+    std::atomic<uint64_t> rewritten_{0};
+    std::thread compactor_;
+};
+
+// Кодирование записи: общее для журнала и для тех, кто пишет сегменты сам
+void encodeLogRecord(int64_t ts, float value, unsigned char* out);
+bool decodeLogRecord(const unsigned char* in, LogRecord& record);
+
+#endif // SEGMENT_LOG_H
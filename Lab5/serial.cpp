@@ -4,6 +4,8 @@
 #include <thread>
 #include <cstring>
 #include <string>
+#include <algorithm>
+#include <utility>
 
 #ifdef _WIN32
     #include <windows.h>
@@ -12,9 +14,106 @@
     #include <termios.h>
     #include <unistd.h>
     #include <poll.h>
+    #include <sys/ioctl.h>
 #endif
+#ifdef __linux__
+    #include <asm/ioctls.h>  // TCGETS2 / TCSETS2
+#endif
+
+#if defined(__linux__)
+// termios2 из <asm/termbits.h>: сам заголовок конфликтует с <termios.h> glibc,
+// поэтому структуру объявляем сами. Нужна для произвольной скорости (BOTHER)
+struct termios2 {
+    tcflag_t c_iflag;
+    tcflag_t c_oflag;
+    tcflag_t c_cflag;
+    tcflag_t c_lflag;
+    cc_t c_line;
+    cc_t c_cc[19];
+    speed_t c_ispeed;
+    speed_t c_ospeed;
+};
+#ifndef BOTHER
+    #define BOTHER 0010000
+#endif
+#ifndef IBSHIFT
+    #define IBSHIFT 16
+#endif
+#endif
+
+#ifndef _WIN32
+// Стандартные скорости termios; остальные выставляются через BOTHER
+static bool standardSpeed(unsigned baud, speed_t& out) {
+    static const struct { unsigned baud; speed_t speed; } table[] = {
+        {1200, B1200}, {2400, B2400}, {4800, B4800}, {9600, B9600},
+        {19200, B19200}, {38400, B38400}, {57600, B57600}, {115200, B115200},
+        {230400, B230400},
+#ifdef B460800
+        {460800, B460800},
+#endif
+#ifdef B500000
+        {500000, B500000},
+#endif
+#ifdef B576000
+        {576000, B576000},
+#endif
+#ifdef B921600
+        {921600, B921600},
+#endif
+#ifdef B1000000
+        {1000000, B1000000},
+#endif
+#ifdef B1500000
+        {1500000, B1500000},
+#endif
+#ifdef B2000000
+        {2000000, B2000000},
+#endif
+#ifdef B3000000
+        {3000000, B3000000},
+#endif
+#ifdef B4000000
+        {4000000, B4000000},
+#endif
+    };
+    for (const auto& entry : table) {
+        if (entry.baud == baud) {
+            out = entry.speed;
+            return true;
+        }
+    }
+    return false;
+}
+#endif
+
+bool parseFraming(std::string_view spec, SerialConfig& config) {
+    if (spec.size() != 3) return false;
+    if (spec[0] < '5' || spec[0] > '8') return false;
+    char parity = static_cast<char>(spec[1] & ~0x20);  // в верхний регистр
+    if (parity != 'N' && parity != 'E' && parity != 'O') return false;
+    if (spec[2] != '1' && spec[2] != '2') return false;
+    config.dataBits = spec[0] - '0';
+    config.parity = parity;
+    config.stopBits = spec[2] - '0';
+    return true;
+}
+
+bool parseFlowControl(std::string_view spec, SerialConfig& config) {
+    if (spec == "none") config.flowControl = FlowControl::None;
+    else if (spec == "rtscts") config.flowControl = FlowControl::Hardware;
+    else if (spec == "xonxoff") config.flowControl = FlowControl::Software;
+    else return false;
+    return true;
+}
+
+SerialPort::SerialPort(const std::string& portName, const SerialConfig& config)
+    : rx(RX_CAPACITY), wire(config.protocol) {
+    if (config.baudRate == 0 || config.dataBits < 5 || config.dataBits > 8 ||
+        (config.stopBits != 1 && config.stopBits != 2) ||
+        (config.parity != 'N' && config.parity != 'E' && config.parity != 'O')) {
+        throw std::runtime_error("Invalid serial settings for " + portName);
+    }
 
-SerialPort::SerialPort(const std::string& portName) {
 #ifdef _WIN32
     std::string fullPort = portName;
     if (portName.compare(0, 3, "COM") == 0 && portName.size() > 4) {
@@ -33,12 +132,32 @@ SerialPort::SerialPort(const std::string& portName) {
         throw std::runtime_error("Failed to open port: " + portName);
     }
 
+    // Очереди драйвера побольше, чтобы высокая скорость не упиралась в них между чтениями
+    SetupComm(static_cast<HANDLE>(handle), static_cast<DWORD>(RX_CAPACITY), 4096);
+
     DCB dcb = {0};
     dcb.DCBlength = sizeof(dcb);
-    dcb.BaudRate = CBR_9600;
-    dcb.ByteSize = 8;
-    dcb.StopBits = ONESTOPBIT;
-    dcb.Parity = NOPARITY;
+    dcb.fBinary = TRUE;
+    dcb.BaudRate = config.baudRate;  // драйвер принимает и нестандартные значения
+    dcb.ByteSize = static_cast<BYTE>(config.dataBits);
+    dcb.StopBits = config.stopBits == 2 ? TWOSTOPBITS : ONESTOPBIT;
+    dcb.Parity = config.parity == 'E' ? EVENPARITY : config.parity == 'O' ? ODDPARITY : NOPARITY;
+    dcb.fParity = config.parity != 'N';
+    dcb.fDtrControl = DTR_CONTROL_ENABLE;
+    if (config.flowControl == FlowControl::Hardware) {
+        dcb.fOutxCtsFlow = TRUE;
+        dcb.fRtsControl = RTS_CONTROL_HANDSHAKE;
+    } else {
+        dcb.fRtsControl = RTS_CONTROL_ENABLE;
+    }
+    if (config.flowControl == FlowControl::Software) {
+        dcb.fOutX = TRUE;
+        dcb.fInX = TRUE;
+        dcb.XonChar = 0x11;
+        dcb.XoffChar = 0x13;
+        dcb.XonLim = 2048;
+        dcb.XoffLim = 512;
+    }
     if (!SetCommState(static_cast<HANDLE>(handle), &dcb)) {
         CloseHandle(static_cast<HANDLE>(handle));
         throw std::runtime_error("Failed to configure port: " + portName);
@@ -53,7 +172,7 @@ SerialPort::SerialPort(const std::string& portName) {
     SetCommTimeouts(static_cast<HANDLE>(handle), &timeouts);
 
 #else
-    fd = open(portName.c_str(), O_RDWR | O_NOCTTY | O_SYNC);
+    fd = open(portName.c_str(), O_RDWR | O_NOCTTY);
     if (fd < 0) {
         throw std::runtime_error("Failed to open port: " + portName);
     }
@@ -66,23 +185,66 @@ SerialPort::SerialPort(const std::string& portName) {
     }
 
     cfmakeraw(&tty);
-    tty.c_cflag &= ~CSTOPB;   // 1 stop bit
-    tty.c_cflag &= ~PARENB;   // No parity
+    tty.c_cflag |= CLOCAL | CREAD;
+
     tty.c_cflag &= ~CSIZE;
-    tty.c_cflag |= CS8;       // 8 bits
-    tty.c_cflag &= ~CRTSCTS;  // No flow control
+    switch (config.dataBits) {
+        case 5: tty.c_cflag |= CS5; break;
+        case 6: tty.c_cflag |= CS6; break;
+        case 7: tty.c_cflag |= CS7; break;
+        default: tty.c_cflag |= CS8; break;
+    }
+
+    tty.c_cflag &= ~(PARENB | PARODD);
+    if (config.parity != 'N') {
+        tty.c_cflag |= PARENB;
+        if (config.parity == 'O') tty.c_cflag |= PARODD;
+    }
+
+    if (config.stopBits == 2) tty.c_cflag |= CSTOPB;
+    else tty.c_cflag &= ~CSTOPB;
+
+    tty.c_cflag &= ~CRTSCTS;
+    tty.c_iflag &= ~(IXON | IXOFF | IXANY);
+    if (config.flowControl == FlowControl::Hardware) tty.c_cflag |= CRTSCTS;
+    if (config.flowControl == FlowControl::Software) tty.c_iflag |= IXON | IXOFF;
 
-    // Скорость 9600
-    cfsetospeed(&tty, B9600);
-    cfsetispeed(&tty, B9600);
+    speed_t speed;
+    bool standard = standardSpeed(config.baudRate, speed);
+    if (!standard) speed = B38400;  // временно; настоящую скорость выставит BOTHER ниже
+    cfsetospeed(&tty, speed);
+    cfsetispeed(&tty, speed);
 
-    tty.c_cc[VMIN] = 0;       // Мин. количество символов для чтения
-    tty.c_cc[VTIME] = 10; // Таймаут 1 секунда
+    // Ожидание данных целиком на poll с дедлайном, поэтому read не ждёт ничего:
+    // VMIN = 0, VTIME = 0 — отдать сразу всё, что есть в буфере драйвера
+    tty.c_cc[VMIN] = 0;
+    tty.c_cc[VTIME] = 0;
 
     if (tcsetattr(fd, TCSANOW, &tty) != 0) {
         close(fd);
         throw std::runtime_error("Failed to set port attributes");
     }
+
+    if (!standard) {
+#if defined(__linux__)
+        termios2 tty2;
+        if (ioctl(fd, TCGETS2, &tty2) != 0) {
+            close(fd);
+            throw std::runtime_error("Failed to get port attributes");
+        }
+        tty2.c_cflag &= ~(CBAUD | (CBAUD << IBSHIFT));
+        tty2.c_cflag |= BOTHER | (BOTHER << IBSHIFT);
+        tty2.c_ispeed = config.baudRate;
+        tty2.c_ospeed = config.baudRate;
+        if (ioctl(fd, TCSETS2, &tty2) != 0) {
+            close(fd);
+            throw std::runtime_error("Baud rate " + std::to_string(config.baudRate) + " not supported by " + portName);
+        }
+#else
+        close(fd);
+        throw std::runtime_error("Non-standard baud rate " + std::to_string(config.baudRate) + " is not supported");
+#endif
+    }
 #endif
 }
 
@@ -107,55 +269,209 @@ bool SerialPort::isOpen() const {
 }
 
 void SerialPort::writeLine(std::string_view data) {
-    std::string msg = std::string(data) + "\n";
+    writeBytes(std::string(data) + "\n");
+}
 
+void SerialPort::writeBytes(std::string_view msg) {
 #ifdef _WIN32
     DWORD bytesWritten = 0;
-    WriteFile(static_cast<HANDLE>(handle), msg.c_str(), static_cast<DWORD>(msg.size()), &bytesWritten, nullptr);
+    WriteFile(static_cast<HANDLE>(handle), msg.data(), static_cast<DWORD>(msg.size()), &bytesWritten, nullptr);
 #else
-    write(fd, msg.c_str(), msg.size());
+    size_t written = 0;
+    while (written < msg.size()) {
+        ssize_t n = write(fd, msg.data() + written, msg.size() - written);
+        if (n <= 0) break;
+        written += static_cast<size_t>(n);
+    }
 #endif
 }
 
-std::string SerialPort::readLine(int timeoutMs) {
-    std::string line;
-    const int maxWaitMs = timeoutMs;
-    const auto start = std::chrono::steady_clock::now();
+bool SerialPort::fillBuffer(int timeoutMs) {
+    if (rxSize == RX_CAPACITY) return false;
+    if (timeoutMs < 0) timeoutMs = 0;
+
+    // Читаем в непрерывный свободный участок кольца за хвостом
+    size_t tail = (rxHead + rxSize) % RX_CAPACITY;
+    size_t space = std::min(RX_CAPACITY - rxSize, RX_CAPACITY - tail);
 
 #ifdef _WIN32
-    while (true) {
-        char c;
-        DWORD bytesRead = 0;
-        bool success = ReadFile(static_cast<HANDLE>(handle), &c, 1, &bytesRead, nullptr);
-        if (success && bytesRead == 1) {
-            if (c == '\n') break;
-            if (c != '\r') line += c;
-        } else {
-            // Проверяем таймаут
-            auto now = std::chrono::steady_clock::now();
-            auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - start).count();
-            if (elapsed >= maxWaitMs) break;
-            std::this_thread::sleep_for(std::chrono::milliseconds(1));
-        }
+    // MAXDWORD/MAXDWORD/N: ReadFile возвращается, как только есть хоть один байт,
+    // иначе ждёт не дольше N мс
+    if (appliedTimeoutMs != timeoutMs) {
+        COMMTIMEOUTS timeouts = {0};
+        timeouts.ReadIntervalTimeout = MAXDWORD;
+        timeouts.ReadTotalTimeoutMultiplier = timeoutMs > 0 ? MAXDWORD : 0;
+        timeouts.ReadTotalTimeoutConstant = static_cast<DWORD>(timeoutMs);
+        timeouts.WriteTotalTimeoutConstant = 100;
+        SetCommTimeouts(static_cast<HANDLE>(handle), &timeouts);
+        appliedTimeoutMs = timeoutMs;
     }
+    DWORD bytesRead = 0;
+    if (!ReadFile(static_cast<HANDLE>(handle), rx.data() + tail, static_cast<DWORD>(space), &bytesRead, nullptr) ||
+        bytesRead == 0) {
+        return false;
+    }
+    if (capture) capture->record(rx.data() + tail, bytesRead);
+    rxSize += bytesRead;
 #else
+    struct pollfd pfd = { fd, POLLIN, 0 };
+    if (poll(&pfd, 1, timeoutMs) <= 0) return false;
+    if (!(pfd.revents & POLLIN)) {
+        // Другая сторона закрыта: poll будет возвращаться сразу, поэтому
+        // выдерживаем таймаут сами, чтобы вызывающий цикл не крутился вхолостую
+        std::this_thread::sleep_for(std::chrono::milliseconds(timeoutMs));
+        return false;
+    }
+    ssize_t n = read(fd, rx.data() + tail, space);
+    if (n <= 0) return false;
+    if (capture) capture->record(rx.data() + tail, static_cast<size_t>(n));
+    rxSize += static_cast<size_t>(n);
+#endif
+    return true;
+}
+
+void SerialPort::detectProtocol() {
+    bool printable = true;
+    for (size_t i = 0; i < rxSize; ++i) {
+        unsigned char c = static_cast<unsigned char>(rx[(rxHead + i) % RX_CAPACITY]);
+        if (c == 0) {
+            wire = WireProtocol::Binary;
+            return;
+        }
+        if (c == '\n') {
+            // Непечатная строка — скорее всего хвост двоичного кадра, ждём 0x00
+            if (printable) {
+                wire = WireProtocol::Text;
+                return;
+            }
+            printable = true;
+            continue;
+        }
+        if ((c < 0x20 || c > 0x7E) && c != '\r') printable = false;
+    }
+    // Кольцо забито и ничего не понятно — считаем поток текстовым, чтобы не встать
+    if (rxSize == RX_CAPACITY) wire = WireProtocol::Text;
+}
+
+bool SerialPort::popLine(std::string& line) {
+    if (wire == WireProtocol::Auto) {
+        detectProtocol();
+        if (wire == WireProtocol::Auto) return false;
+    }
+    const char delimiter = wire == WireProtocol::Binary ? '\0' : '\n';
+
+    // Ищем разделитель только в ещё не просмотренной части
+    size_t len = rxScanned;
+    while (len < rxSize && rx[(rxHead + len) % RX_CAPACITY] != delimiter) ++len;
+    if (len == rxSize) {
+        // Кольцо заполнено строкой без разделителя — отдаём её как есть, иначе приём встанет
+        if (rxSize < RX_CAPACITY) {
+            rxScanned = len;
+            return false;
+        }
+    }
+
+    line.clear();
+    line.reserve(len);
+    for (size_t i = 0; i < len; ++i) {
+        char c = rx[(rxHead + i) % RX_CAPACITY];
+        if (c != '\r' || wire == WireProtocol::Binary) line += c;
+    }
+    size_t consumed = len < rxSize ? len + 1 : len;
+    rxHead = (rxHead + consumed) % RX_CAPACITY;
+    rxSize -= consumed;
+    rxScanned = 0;
+    return true;
+}
+
+size_t SerialPort::readLines(std::vector<std::string>& out, int timeoutMs) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    size_t added = 0;
+    std::string line;
+
     while (true) {
-        struct pollfd pfd = { fd, POLLIN, 0 };
-        int ret = poll(&pfd, 1, 1); // ждём 1 мс
-        if (ret > 0 && (pfd.revents & POLLIN)) {
-            char c;
-            ssize_t n = read(fd, &c, 1);
-            if (n == 1) {
-                if (c == '\n') break;
-                if (c != '\r') line += c;
+        // Забираем то, что уже лежит в порту, но не больше одного кольца за вызов:
+        // при непрерывном потоке иначе не вернёмся в epoll к другим датчикам.
+        // Остаток epoll (level-triggered) отдаст на следующем круге
+        size_t taken = 0;
+        while (taken < RX_CAPACITY) {
+            size_t before = rxSize;
+            if (!fillBuffer(0)) break;
+            taken += rxSize - before;
+            while (popLine(line)) {
+                out.push_back(line);
+                added++;
             }
         }
+        while (popLine(line)) {
+            out.push_back(line);
+            added++;
+        }
+        if (added > 0) return added;
 
-        auto now = std::chrono::steady_clock::now();
-        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - start).count();
-        if (elapsed >= maxWaitMs) break;
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now()).count();
+        if (left <= 0 || !fillBuffer(static_cast<int>(left))) {
+            if (std::chrono::steady_clock::now() >= deadline) return 0;
+        }
+    }
+}
+
+size_t SerialPort::readAvailable(char* buffer, size_t size) {
+    if (size == 0) return 0;
+
+    // Сначала отдаём то, что уже накоплено в кольце
+    if (rxSize > 0) {
+        size_t n = std::min(size, rxSize);
+        for (size_t i = 0; i < n; ++i) buffer[i] = rx[(rxHead + i) % RX_CAPACITY];
+        rxHead = (rxHead + n) % RX_CAPACITY;
+        rxSize -= n;
+        rxScanned = 0;
+        return n;
+    }
+
+#ifdef _WIN32
+    COMSTAT stat;
+    DWORD errors = 0;
+    if (!ClearCommError(static_cast<HANDLE>(handle), &errors, &stat) || stat.cbInQue == 0) {
+        return 0;
     }
+    DWORD toRead = stat.cbInQue < size ? stat.cbInQue : static_cast<DWORD>(size);
+    DWORD bytesRead = 0;
+    if (!ReadFile(static_cast<HANDLE>(handle), buffer, toRead, &bytesRead, nullptr)) {
+        return 0;
+    }
+    if (capture) capture->record(buffer, bytesRead);
+    return bytesRead;
+#else
+    struct pollfd pfd = { fd, POLLIN, 0 };
+    if (poll(&pfd, 1, 0) <= 0 || !(pfd.revents & POLLIN)) {
+        return 0;
+    }
+    ssize_t n = read(fd, buffer, size);
+    if (n <= 0) return 0;
+    if (capture) capture->record(buffer, static_cast<size_t>(n));
+    return static_cast<size_t>(n);
 #endif
+}
+
+bool SerialPort::startCapture(const std::string& path) {
+    auto writer = std::make_unique<CaptureWriter>();
+    if (!writer->open(path)) return false;
+    capture = std::move(writer);
+    return true;
+}
 
+std::string SerialPort::readLine(int timeoutMs) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    std::string line;
+
+    // Каждое ожидание — ровно на оставшееся до дедлайна время, без опроса по 1 мс
+    while (!popLine(line)) {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now()).count();
+        if (left <= 0) return std::string();
+        fillBuffer(static_cast<int>(left));
+    }
     return line;
-}
\ No newline at end of file
+}
@@ -1,23 +1,96 @@
 #ifndef SERIAL_H
 #define SERIAL_H
 
+#include "capture.h"
+#include <memory>
 #include <string>
 #include <string_view>
+#include <vector>
+
+enum class FlowControl { None, Hardware, Software };
+
+// Протокол датчика: текстовые строки "23.4;179\n" или двоичные COBS-кадры,
+// завершённые 0x00 (см. utils.h). Auto — определить по первым принятым данным
+enum class WireProtocol { Auto, Text, Binary };
+
+// Параметры линии. Скорость может быть любой: стандартные значения
+// выставляются через termios, остальные — через termios2/BOTHER (Linux)
+// или напрямую в DCB (Windows)
+struct SerialConfig {
+    unsigned baudRate = 9600;
+    int dataBits = 8;        // 5..8
+    char parity = 'N';       // 'N', 'E' или 'O'
+    int stopBits = 1;        // 1 или 2
+    FlowControl flowControl = FlowControl::None;
+    WireProtocol protocol = WireProtocol::Auto;
+};
+
+// Разбор настроек из командной строки: "8N1", "7E2" и "none" / "rtscts" / "xonxoff"
+bool parseFraming(std::string_view spec, SerialConfig& config);
+bool parseFlowControl(std::string_view spec, SerialConfig& config);
 
 class SerialPort {
 public:
-    explicit SerialPort(const std::string& portName);
+    explicit SerialPort(const std::string& portName, const SerialConfig& config = SerialConfig());
     ~SerialPort();
 
     SerialPort(const SerialPort&) = delete;
     SerialPort& operator=(const SerialPort&) = delete;
 
     bool isOpen() const;
-    std::string readLine(int timeoutMs = 1000);  // читает до '\n'
+    // Читает до '\n'. По таймауту возвращает пустую строку, а начатая строка
+    // остаётся в буфере до следующего вызова
+    std::string readLine(int timeoutMs = 1000);
     void writeLine(std::string_view data);
 
+    // Добавляет в out целые строки, которые уже пришли (читая за вызов не больше
+    // RX_CAPACITY байт). Если их нет, ждёт первую не дольше timeoutMs.
+    // Возвращает число добавленных строк.
+    // В двоичном режиме readLine/readLines возвращают COBS-кадры без 0x00
+    size_t readLines(std::vector<std::string>& out, int timeoutMs = 0);
+
+    // Пишет байты как есть (двоичные кадры)
+    void writeBytes(std::string_view data);
+
+    // Протокол порта; пока не определён — Auto
+    WireProtocol protocol() const { return wire; }
+
+    // Забирает уже пришедшие байты, не дожидаясь новых; возвращает их количество
+    size_t readAvailable(char* buffer, size_t size);
+
+    // Начинает писать всё принятое из порта в файл записи (см. capture.h);
+    // false, если файл не создать
+    bool startCapture(const std::string& path);
+
+#ifndef _WIN32
+    // Дескриптор для poll/epoll, когда один поток обслуживает несколько портов
+    int nativeHandle() const { return fd; }
+#endif
+
 private:
+    // Приёмное кольцо: заполняется блоками по одному системному вызову,
+    // строки вынимаются из него без побайтового чтения порта
+    static const size_t RX_CAPACITY = 64 * 1024;
+
+    // Дочитывает в кольцо всё, что есть; ждёт данных не дольше timeoutMs.
+    // Возвращает false, если ничего не пришло
+    bool fillBuffer(int timeoutMs);
+    // Вынимает из кольца одну строку без '\n' и '\r' (или кадр без 0x00);
+    // false, если целой строки нет
+    bool popLine(std::string& line);
+    // Определяет протокол по накопленным байтам: 0x00 бывает только в двоичном
+    // потоке, а текстовая строка целиком состоит из печатных символов
+    void detectProtocol();
+
+    std::vector<char> rx;
+    size_t rxHead = 0;     // начало непрочитанных данных
+    size_t rxSize = 0;     // сколько байт в кольце
+    size_t rxScanned = 0;  // сколько байт от rxHead уже проверено на разделитель
+    WireProtocol wire = WireProtocol::Auto;
+    std::unique_ptr<CaptureWriter> capture;  // nullptr — запись не ведётся
+
 #ifdef _WIN32
+    int appliedTimeoutMs = -1;  // таймаут, выставленный в SetCommTimeouts
     void* handle = nullptr;  // HANDLE -> void* чтобы не тянуть windows.h в заголовок
 #else
     int fd = -1;
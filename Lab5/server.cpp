@@ -6,10 +6,17 @@
 #include <sstream>
 #include <ctime>
 #include <cstring>
+#include <cstdlib>
 #include <sqlite3.h>
 #include <fstream>    // ← для чтения index.html
 #include <map>        // ← для парсинга параметров
 #include <algorithm>  // ← для std::find
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <mutex>
+#include <condition_variable>
 
 #ifdef _WIN32
     #include <winsock2.h>
@@ -20,130 +27,267 @@
     #include <netinet/in.h>
     #include <unistd.h>
     #include <arpa/inet.h>
+    #include <cerrno>
     #define SOCKET int
     #define INVALID_SOCKET -1
     #define SOCKET_ERROR -1
     #define closesocket close
 #endif
 
+#ifdef __linux__
+    #include <sys/epoll.h>
+#endif
+
+#ifndef _WIN32
+    #include <csignal>
+    #include <pthread.h>
+#endif
+
 #include "serial.h"
 #include "utils.h"
+#include "database.h"
+#include "hot_tier.h"
+#include "agg_index.h"
+#include "quantile_sketch.h"
+#include "snapshot.h"
+#include "spool.h"
+#include "spsc_ring.h"
+#include "window_agg.h"
+#include "time_fmt.h"
 
 const char* DB_PATH = "temperature.db";
 const int HTTP_PORT = 8080;
 
+// Горизонт и ёмкость кольца в памяти (меняются аргументами --hot-hours / --hot-capacity)
+static int hotTierHours = 24;
+static size_t hotTierCapacity = 0;  // 0 — по одному измерению в секунду на весь горизонт
+
+// Настройки линии для всех портов (--baud / --framing / --flow)
+static SerialConfig serialConfig;
+
+// Каталог для записи сырого трафика портов (--capture-dir); пусто — не пишем
+static std::string captureDir;
+
+// Строка (или двоичный кадр), принятая с порта и ждущая обработки
+struct ReceivedLine {
+    std::string data;
+    time_t received = 0;
+    bool binary = false;
+};
+
+// Очередь между потоком чтения портов и потоком обработки: чтение никогда не
+// ждёт ни диска, ни консоли. При переполнении строки отбрасываются и считаются
+const size_t INGEST_QUEUE_CAPACITY = 16384;
+const size_t INGEST_BATCH = 1024;
+using IngestQueue = SpscRing<ReceivedLine, INGEST_QUEUE_CAPACITY>;
+
+// Сколько секунд окно средних ждёт опоздавшие значения после своего конца
+const time_t WINDOW_LATENESS = 5;
+
+// Один датчик = один последовательный порт. sensor_id совпадает с порядком --port
+struct SensorChannel {
+    int id = 0;
+    std::string portName;
+    std::unique_ptr<SerialPort> port;   // только поток чтения
+    std::atomic<bool> online{false};     // порт открыт; это и читает HTTP-поток
+    std::unique_ptr<IngestQueue> queue;  // пишет поток чтения, читает поток обработки
+    uint64_t reportedDrops = 0;          // сколько потерь уже попало в лог
+    std::unique_ptr<WindowAggregator> hourlyWindows;  // окна по часам и суткам,
+    std::unique_ptr<WindowAggregator> dailyWindows;   // их ведёт поток обработки
+    std::unique_ptr<HotTier> hotTier;
+    uint16_t lastSeq = 0;             // seq последнего двоичного кадра
+    bool haveSeq = false;
+    // Часы датчика: время хоста = device_time_ms + deviceOffsetMs
+    int64_t deviceOffsetMs = 0;
+    uint32_t lastDeviceTimeMs = 0;
+    uint32_t samplePeriodMs = 0;      // шаг отсчётов по соседним кадрам; 0 — ещё не знаем
+    bool haveDeviceClock = false;
+    bool sensorIdWarned = false;
+};
+
+// Заполняется в main до старта потоков и дальше не меняется
+static std::vector<SensorChannel> sensors;
+
+// Часовые скетчи для квантилей (/quantiles)
+static HourlySketchStore hourlySketches;
+
+// Журнал между приёмом и БД: processLine пишет в него, отдельный поток переносит в SQLite
+static std::unique_ptr<IngestSpool> spool;
+
+// Сколько секунд при старте ждём, пока остаток спула перенесётся в БД
+const int SPOOL_DRAIN_TIMEOUT_SEC = 10;
+
+// Онлайн-снимки базы (/admin/snapshot, SIGUSR1); каталог задаётся --snapshot-dir
+static std::unique_ptr<SnapshotManager> snapshots;
+
+SensorChannel* findSensor(int sensorId) {
+    for (auto& s : sensors) {
+        if (s.id == sensorId) return &s;
+    }
+    return nullptr;
+}
+
 // DATABASE 
 
-bool initDatabase() {
+// Переносит пачку измерений из спула в БД. Позиция спула (spool_state) и часовые
+// скетчи меняются в той же транзакции, поэтому повторный перенос после сбоя ничего не задвоит
+bool saveMeasurementsToDB(const std::vector<SpoolRecord>& batch) {
     sqlite3* db;
     int rc = sqlite3_open(DB_PATH, &db);
     if (rc != SQLITE_OK) {
-        std::cerr << "[DB] Cannot open database: " << sqlite3_errmsg(db) << "\n";
         sqlite3_close(db);
         return false;
     }
+    sqlite3_busy_timeout(db, 1000);
 
-    const char* sql1 = R"(
-        CREATE TABLE IF NOT EXISTS measurements (
-            id INTEGER PRIMARY KEY AUTOINCREMENT,
-            timestamp INTEGER NOT NULL,
-            temperature REAL NOT NULL
-        );
-    )";
-
-    const char* sql2 = R"(
-        CREATE TABLE IF NOT EXISTS hourly_averages (
-            id INTEGER PRIMARY KEY AUTOINCREMENT,
-            timestamp INTEGER NOT NULL,
-            average REAL NOT NULL
-        );
-    )";
-
-    const char* sql3 = R"(
-        CREATE TABLE IF NOT EXISTS daily_averages (
-            id INTEGER PRIMARY KEY AUTOINCREMENT,
-            timestamp INTEGER NOT NULL,
-            average REAL NOT NULL
-        );
-    )";
-
-    char* errMsg = nullptr;
-    rc = sqlite3_exec(db, sql1, nullptr, nullptr, &errMsg);
-    if (rc != SQLITE_OK) {
-        std::cerr << "[DB] Error creating measurements: " << errMsg << "\n";
-        sqlite3_free(errMsg);
+    // Измерения, индекс агрегатов, скетчи и позиция спула меняются одной транзакцией
+    if (sqlite3_exec(db, "BEGIN IMMEDIATE;", nullptr, nullptr, nullptr) != SQLITE_OK) {
         sqlite3_close(db);
         return false;
     }
 
-    rc = sqlite3_exec(db, sql2, nullptr, nullptr, &errMsg);
+    const char* sql = "INSERT INTO measurements (sensor_id, timestamp, temperature) VALUES (?, ?, ?);";
+    sqlite3_stmt* stmt;
+    rc = sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr);
     if (rc != SQLITE_OK) {
-        std::cerr << "[DB] Error creating hourly_averages: " << errMsg << "\n";
-        sqlite3_free(errMsg);
+        sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
         sqlite3_close(db);
         return false;
     }
 
-    rc = sqlite3_exec(db, sql3, nullptr, nullptr, &errMsg);
-    if (rc != SQLITE_OK) {
-        std::cerr << "[DB] Error creating daily_averages: " << errMsg << "\n";
-        sqlite3_free(errMsg);
-        sqlite3_close(db);
-        return false;
+    bool ok = true;
+    for (size_t i = 0; i < batch.size() && ok; ++i) {
+        const SpoolRecord& r = batch[i];
+        sqlite3_bind_int(stmt, 1, r.sensorId);
+        sqlite3_bind_int64(stmt, 2, static_cast<sqlite3_int64>(r.timestamp));
+        sqlite3_bind_double(stmt, 3, static_cast<double>(r.value));
+        ok = sqlite3_step(stmt) == SQLITE_DONE &&
+             addToAggregateIndex(db, r.sensorId, static_cast<time_t>(r.timestamp), r.value);
+        sqlite3_reset(stmt);
     }
+    sqlite3_finalize(stmt);
 
+    // Скетчи часов пачки пишутся в той же транзакции: /quantiles не разойдётся с measurements
+    if (ok) {
+        for (const SpoolRecord& r : batch) {
+            hourlySketches.add(db, r.sensorId, static_cast<time_t>(r.timestamp), r.value);
+        }
+        ok = hourlySketches.save(db);
+    }
+    ok = ok && writeSpoolPosition(db, batch.back().seq);
+    ok = ok && sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr) == SQLITE_OK;
+    if (!ok) {
+        sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+        hourlySketches.rollback();
+    } else {
+        hourlySketches.commit(static_cast<time_t>(batch.back().timestamp));
+        std::cout << "[DB] Saved " << batch.size() << " measurement(s)\n";
+    }
     sqlite3_close(db);
-    std::cout << "[DB] Database initialized\n";
-    return true;
+    return ok;
 }
 
-bool saveMeasurementToDB(float temp) {
+// Итог закрытого окна в hourly_averages / daily_averages: одна строка в час,
+// поэтому пишем сразу, без спула
+bool saveAverageToDB(const char* table, int sensorId, time_t windowStart, double average) {
     sqlite3* db;
-    int rc = sqlite3_open(DB_PATH, &db);
-    if (rc != SQLITE_OK) return false;
-
-    time_t now = std::time(nullptr);
-    const char* sql = "INSERT INTO measurements (timestamp, temperature) VALUES (?, ?);";
-    sqlite3_stmt* stmt;
-    rc = sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
+    if (sqlite3_open(DB_PATH, &db) != SQLITE_OK) {
         sqlite3_close(db);
         return false;
     }
-    sqlite3_bind_int64(stmt, 1, static_cast<sqlite3_int64>(now));
-    sqlite3_bind_double(stmt, 2, static_cast<double>(temp));
-    sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    sqlite3_busy_timeout(db, 1000);
+    std::string sql = std::string("INSERT INTO ") + table + " (sensor_id, timestamp, average) VALUES (?, ?, ?);";
+    sqlite3_stmt* stmt;
+    bool ok = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) == SQLITE_OK;
+    if (ok) {
+        sqlite3_bind_int(stmt, 1, sensorId);
+        sqlite3_bind_int64(stmt, 2, static_cast<sqlite3_int64>(windowStart));
+        sqlite3_bind_double(stmt, 3, average);
+        ok = sqlite3_step(stmt) == SQLITE_DONE;
+        sqlite3_finalize(stmt);
+    }
+    if (!ok) std::cerr << "[DB] Cannot save to " << table << ": " << sqlite3_errmsg(db) << "\n";
     sqlite3_close(db);
-    return true;
+    return ok;
 }
 
-std::string buildHistoryJSON(time_t start, time_t end) {
+// Кладёт в кольцо измерения датчика из БД начиная с from. В той же транзакции
+// читает позицию спула: всё, что новее её, кольцо должно взять из спула
+static bool loadHotTierFromDB(SensorChannel& sensor, time_t from, uint64_t& spoolPosition, size_t& loaded) {
     sqlite3* db;
-    sqlite3_open(DB_PATH, &db);
-
-    std::vector<std::pair<time_t, float>> data;
-    double sum = 0.0;
-    int count = 0;
+    if (sqlite3_open(DB_PATH, &db) != SQLITE_OK) {
+        sqlite3_close(db);
+        return false;
+    }
+    sqlite3_busy_timeout(db, 1000);
 
-    const char* sql = "SELECT timestamp, temperature FROM measurements WHERE timestamp BETWEEN ? AND ? ORDER BY timestamp;";
+    bool ok = sqlite3_exec(db, "BEGIN;", nullptr, nullptr, nullptr) == SQLITE_OK;
     sqlite3_stmt* stmt;
-    sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr);
-    sqlite3_bind_int64(stmt, 1, start);
-    sqlite3_bind_int64(stmt, 2, end);
+    if (ok && sqlite3_prepare_v2(db, "SELECT last_seq FROM spool_state WHERE id = 0;", -1, &stmt, nullptr) == SQLITE_OK) {
+        ok = sqlite3_step(stmt) == SQLITE_ROW;
+        if (ok) spoolPosition = static_cast<uint64_t>(sqlite3_column_int64(stmt, 0));
+        sqlite3_finalize(stmt);
+    } else {
+        ok = false;
+    }
 
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-        time_t ts = sqlite3_column_int64(stmt, 0);
-        double temp = sqlite3_column_double(stmt, 1);
-        data.emplace_back(ts, static_cast<float>(temp));
-        sum += temp;
-        count++;
+    const char* sql = "SELECT timestamp, temperature FROM measurements WHERE sensor_id = ? AND timestamp >= ? ORDER BY timestamp;";
+    if (ok && sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) == SQLITE_OK) {
+        sqlite3_bind_int(stmt, 1, sensor.id);
+        sqlite3_bind_int64(stmt, 2, from);
+        int rc;
+        while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+            sensor.hotTier->push(sqlite3_column_int64(stmt, 0), static_cast<float>(sqlite3_column_double(stmt, 1)));
+            loaded++;
+        }
+        ok = rc == SQLITE_DONE;
+        sqlite3_finalize(stmt);
+    } else {
+        ok = false;
     }
-    sqlite3_finalize(stmt);
+    if (!ok) std::cerr << "[HotTier] Sensor " << sensor.id << ": cannot read DB: " << sqlite3_errmsg(db) << "\n";
+    sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
     sqlite3_close(db);
+    return ok;
+}
+
+// Загружает последние horizon() секунд датчика в его кольцо: из БД и из спула,
+// который поток переноса ещё не донёс до БД (база при старте может быть занята).
+// startupPosition — позиция спула при запуске, на случай если БД не читается
+void warmHotTier(SensorChannel& sensor, uint64_t startupPosition) {
+    HotTier& hotTier = *sensor.hotTier;
+    time_t from = std::time(nullptr) - hotTier.horizon();
+
+    // Пока мы читаем, перенос может удалить из спула то, что было новее прочитанного
+    // из БД, — тогда читаем заново
+    for (int attempt = 0; attempt < 3; ++attempt) {
+        hotTier.reset(from);
+        size_t fromDB = 0;
+        size_t fromSpool = 0;
+        uint64_t position = startupPosition;
+        if (!loadHotTierFromDB(sensor, from, position, fromDB)) {
+            hotTier.reset(from);
+            fromDB = 0;
+            position = startupPosition;
+        }
+        bool complete = spool->pending(position, [&](const SpoolRecord& r) {
+            if (r.sensorId != sensor.id || r.timestamp < from) return;
+            hotTier.push(static_cast<time_t>(r.timestamp), r.value);
+            fromSpool++;
+        });
+        if (complete) {
+            std::cout << "[HotTier] Sensor " << sensor.id << ": loaded " << fromDB << " measurements from DB and "
+                      << fromSpool << " from spool (last " << hotTierHours << " h)\n";
+            return;
+        }
+    }
+    std::cerr << "[HotTier] Sensor " << sensor.id << ": spool moved on while loading, ring may miss measurements\n";
+}
 
+std::string historyToJSON(int sensorId, const std::vector<std::pair<time_t, float>>& data, const Aggregate& stats) {
     std::stringstream ss;
     ss << "{\n";
+    ss << "  \"sensor_id\":" << sensorId << ",\n";
     ss << "  \"measurements\": [\n";
     for (size_t i = 0; i < data.size(); ++i) {
         ss << "    {\"value\":" << data[i].second << ",\"timestamp\":" << data[i].first << "}";
@@ -151,36 +295,160 @@ std::string buildHistoryJSON(time_t start, time_t end) {
         ss << "\n";
     }
     ss << "  ],\n";
-    ss << "  \"average\":" << (count > 0 ? sum / count : 0.0) << "\n";
+    ss << "  \"average\":" << stats.average() << ",\n";
+    ss << "  \"min\":" << stats.min << ",\n";
+    ss << "  \"max\":" << stats.max << ",\n";
+    ss << "  \"count\":" << stats.count << "\n";
     ss << "}";
     return ss.str();
 }
 
-std::string getLastMeasurementJSON() {
+std::string buildHistoryJSON(int sensorId, time_t start, time_t end) {
+    std::vector<std::pair<time_t, float>> data;
+    Aggregate stats;
+
+    // Свежий диапазон отдаём из памяти, в SQLite идём только за старыми данными
+    SensorChannel* sensor = findSensor(sensorId);
+    if (sensor && sensor->hotTier->query(start, end, data)) {
+        for (const auto& [ts, temp] : data) stats.add(temp);
+        return historyToJSON(sensorId, data, stats);
+    }
+
     sqlite3* db;
     sqlite3_open(DB_PATH, &db);
 
-    const char* sql = "SELECT timestamp, temperature FROM measurements ORDER BY timestamp DESC LIMIT 1;";
+    const char* sql = "SELECT timestamp, temperature FROM measurements WHERE sensor_id = ? AND timestamp BETWEEN ? AND ? ORDER BY timestamp;";
     sqlite3_stmt* stmt;
     sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr);
+    sqlite3_bind_int(stmt, 1, sensorId);
+    sqlite3_bind_int64(stmt, 2, start);
+    sqlite3_bind_int64(stmt, 3, end);
+
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        time_t ts = sqlite3_column_int64(stmt, 0);
+        double temp = sqlite3_column_double(stmt, 1);
+        data.emplace_back(ts, static_cast<float>(temp));
+    }
+    sqlite3_finalize(stmt);
+
+    // Итоги берём из индекса агрегатов, а не суммируем строки
+    queryAggregate(db, sensorId, start, end, stats);
+    sqlite3_close(db);
+
+    return historyToJSON(sensorId, data, stats);
+}
+
+std::string buildStatsJSON(int sensorId, time_t start, time_t end) {
+    sqlite3* db;
+    sqlite3_open(DB_PATH, &db);
+    Aggregate stats;
+    queryAggregate(db, sensorId, start, end, stats);
+    sqlite3_close(db);
+
+    std::stringstream ss;
+    ss << "{\n"
+       << "  \"sensor_id\":" << sensorId << ",\n"
+       << "  \"start\":" << start << ",\n"
+       << "  \"end\":" << end << ",\n"
+       << "  \"count\":" << stats.count << ",\n"
+       << "  \"average\":" << stats.average() << ",\n"
+       << "  \"min\":" << stats.min << ",\n"
+       << "  \"max\":" << stats.max << "\n"
+       << "}";
+    return ss.str();
+}
+
+void readLastMeasurement(int sensorId, time_t& ts, float& temp) {
+    sqlite3* db;
+    sqlite3_open(DB_PATH, &db);
+
+    const char* sql = "SELECT timestamp, temperature FROM measurements WHERE sensor_id = ? ORDER BY timestamp DESC LIMIT 1;";
+    sqlite3_stmt* stmt;
+    sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr);
+    sqlite3_bind_int(stmt, 1, sensorId);
 
-    time_t ts = 0;
-    float temp = 0.0f;
     if (sqlite3_step(stmt) == SQLITE_ROW) {
         ts = sqlite3_column_int64(stmt, 0);
         temp = static_cast<float>(sqlite3_column_double(stmt, 1));
     }
     sqlite3_finalize(stmt);
     sqlite3_close(db);
+}
+
+std::string getLastMeasurementJSON(int sensorId) {
+    time_t ts = 0;
+    float temp = 0.0f;
+    SensorChannel* sensor = findSensor(sensorId);
+    if (!sensor || !sensor->hotTier->last(ts, temp)) {
+        readLastMeasurement(sensorId, ts, temp);
+    }
+
+    // Время измерения по местным часам сервера — для отображения без пересчёта на клиенте
+    char local[TIMESTAMP_LENGTH + 1];
+    format_timestamp(static_cast<int64_t>(ts) * 1000, local);
 
     std::stringstream ss;
     ss << "{\n"
+       << "  \"sensor_id\":" << sensorId << ",\n"
        << "  \"value\":" << temp << ",\n"
-       << "  \"timestamp\":" << ts << "\n"
+       << "  \"timestamp\":" << ts << ",\n"
+       << "  \"time\":\"" << std::string(local, 19) << "\"\n"
        << "}";
     return ss.str();
 }
 
+std::string getSensorsJSON() {
+    std::stringstream ss;
+    ss << "{\n  \"sensors\": [\n";
+    for (size_t i = 0; i < sensors.size(); ++i) {
+        ss << "    {\"sensor_id\":" << sensors[i].id
+           << ",\"port\":\"" << sensors[i].portName << "\""
+           << ",\"online\":" << (sensors[i].online.load() ? "true" : "false")
+           << ",\"dropped\":" << sensors[i].queue->dropped() << "}";
+        if (i < sensors.size() - 1) ss << ",";
+        ss << "\n";
+    }
+    ss << "  ],\n  \"spool_backlog\": " << spool->backlog()
+       << ",\n  \"spool_corrupted\": " << spool->corrupted() << "\n}";
+    return ss.str();
+}
+
+std::string buildQuantilesJSON(int sensorId, time_t start, time_t end, const std::vector<double>& qs) {
+    sqlite3* db;
+    sqlite3_open(DB_PATH, &db);
+    QuantileSketch sketch;
+    hourlySketches.query(db, sensorId, start, end, sketch);
+    sqlite3_close(db);
+
+    std::stringstream ss;
+    ss << "{\n"
+       << "  \"sensor_id\":" << sensorId << ",\n"
+       << "  \"start\":" << start << ",\n"
+       << "  \"end\":" << end << ",\n"
+       << "  \"count\":" << sketch.count() << ",\n"
+       << "  \"quantiles\": [\n";
+    for (size_t i = 0; i < qs.size(); ++i) {
+        ss << "    {\"q\":" << qs[i] << ",\"value\":" << sketch.quantile(qs[i]) << "}";
+        if (i < qs.size() - 1) ss << ",";
+        ss << "\n";
+    }
+    ss << "  ]\n}";
+    return ss.str();
+}
+
+// Разбирает список квантилей вида "0.5,0.95,0.99"
+bool parseQuantiles(const std::string& str, std::vector<double>& out) {
+    std::stringstream ss(str);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        size_t used = 0;
+        double q = std::stod(item, &used);
+        if (used != item.size() || !(q >= 0.0 && q <= 1.0)) return false;
+        out.push_back(q);
+    }
+    return !out.empty();
+}
+
 // FILE READER 
 
 std::string readFile(const std::string& path) {
@@ -194,57 +462,238 @@ std::string readFile(const std::string& path) {
 
 // SERIAL THREAD 
 
-static std::vector<float> hourlyBuffer;
-static int totalMeasurements = 0;
+static std::atomic<long long> totalMeasurements{0};
 
-void serialReaderThread() {
-    const std::string PORT_NAME =
-#ifdef _WIN32
-        "COM5";
-#else
-        "/dev/pts/1";
-#endif
+// Учитывает одно проверенное измерение датчика; ts — время приёма строки с порта
+void acceptMeasurement(SensorChannel& sensor, float temp, time_t ts) {
+    // Измерение принято, как только оно в спуле; в БД его донесёт поток переноса
+    if (spool->append(sensor.id, ts, temp)) {
+        sensor.hotTier->push(ts, temp);
+        std::cout << "[Spool] Sensor " << sensor.id << " accepted: " << temp << " C\n";
+    }
 
-    try {
-        SerialPort port(PORT_NAME);
-        std::cout << "[Serial] Listening on " << PORT_NAME << "\n";
+    totalMeasurements++;
+    sensor.hourlyWindows->add(ts, temp);
+    sensor.dailyWindows->add(ts, temp);
+}
 
-        while (true) {
-            std::string line = port.readLine(2000);
-            if (line.empty()) continue;
+// Насколько время кадра по часам датчика может разойтись со временем приёма,
+// прежде чем мы решим, что датчик перезапустился, и заново привяжем его часы
+const int64_t DEVICE_CLOCK_TOLERANCE_MS = 2000;
 
-            float temp;
-            if (!validatePacket(line, temp)) {
-                std::cerr << "[Serial] Invalid  " << line << "\n";
-                continue;
+// Двоичный кадр: несколько отсчётов сразу, пропуски видны по seq.
+// device_time_ms — время последнего отсчёта по часам датчика; отсчёты внутри
+// кадра идут с шагом, который виден по разнице времён соседних кадров
+void processBinaryFrame(SensorChannel& sensor, const std::string& frame, time_t received) {
+    BinaryPacket packet;
+    if (!validatePacket(std::string_view(frame), packet)) {
+        std::cerr << "[Serial] Sensor " << sensor.id << " invalid binary frame (" << frame.size() << " bytes)\n";
+        return;
+    }
+    if (packet.sensorId != sensor.id && !sensor.sensorIdWarned) {
+        // Скорее всего, порты перепутаны в --port; данные всё равно пишем под номером канала
+        std::cerr << "[Serial] Sensor " << sensor.id << " receives frames from sensor_id " << packet.sensorId
+                  << ", storing them as sensor " << sensor.id << "\n";
+        sensor.sensorIdWarned = true;
+    }
+    bool consecutive = sensor.haveSeq && packet.seq == static_cast<uint16_t>(sensor.lastSeq + 1);
+    if (sensor.haveSeq && !consecutive) {
+        std::cerr << "[Serial] Sensor " << sensor.id << " lost "
+                  << static_cast<uint16_t>(packet.seq - sensor.lastSeq - 1) << " frame(s)\n";
+    }
+    sensor.lastSeq = packet.seq;
+    sensor.haveSeq = true;
+    if (packet.samples.empty()) return;
+
+    size_t count = packet.samples.size();
+    if (sensor.haveDeviceClock && consecutive && packet.deviceTimeMs > sensor.lastDeviceTimeMs) {
+        sensor.samplePeriodMs = static_cast<uint32_t>((packet.deviceTimeMs - sensor.lastDeviceTimeMs) / count);
+    }
+    int64_t receivedMs = static_cast<int64_t>(received) * 1000;
+    int64_t hostMs = static_cast<int64_t>(packet.deviceTimeMs) + sensor.deviceOffsetMs;
+    if (!sensor.haveDeviceClock || hostMs - receivedMs > DEVICE_CLOCK_TOLERANCE_MS ||
+        receivedMs - hostMs > DEVICE_CLOCK_TOLERANCE_MS) {
+        sensor.deviceOffsetMs = receivedMs - static_cast<int64_t>(packet.deviceTimeMs);
+        sensor.haveDeviceClock = true;
+        hostMs = receivedMs;
+    }
+    sensor.lastDeviceTimeMs = packet.deviceTimeMs;
+
+    for (size_t i = 0; i < count; ++i) {
+        int64_t sampleMs = hostMs - static_cast<int64_t>(count - 1 - i) * sensor.samplePeriodMs;
+        acceptMeasurement(sensor, static_cast<float>(packet.samples[i]) / 10.0f,
+                          static_cast<time_t>(sampleMs / 1000));
+    }
+}
+
+// Обрабатывает одну принятую строку (или двоичный кадр) от датчика
+void processLine(SensorChannel& sensor, const ReceivedLine& line) {
+    if (line.binary) {
+        processBinaryFrame(sensor, line.data, line.received);
+        return;
+    }
+
+    float temp;
+    if (!validatePacket(line.data, temp)) {
+        std::cerr << "[Serial] Sensor " << sensor.id << " invalid  " << line.data << "\n";
+        return;
+    }
+    acceptMeasurement(sensor, temp, line.received);
+}
+
+// Поток обработки спит, пока очереди пусты; поток чтения будит его после пачки строк
+static std::mutex storageMtx;
+static std::condition_variable storageCv;
+static std::atomic<bool> storageIdle{false};
+
+// Вызывается потоком чтения: только перекладывает строки в очередь датчика
+void enqueueLines(SensorChannel& sensor, std::vector<std::string>& lines) {
+    time_t now = std::time(nullptr);
+    bool binary = sensor.port->protocol() == WireProtocol::Binary;
+    for (auto& line : lines) {
+        if (line.empty()) continue;
+        sensor.queue->tryPush([&](ReceivedLine& slot) {
+            slot.data.swap(line);
+            slot.received = now;
+            slot.binary = binary;
+        });
+    }
+    // Барьер в паре с проверкой очередей в storageThread: либо мы увидим, что
+    // поток обработки уснул, либо он увидит наши строки
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (storageIdle.load()) {
+        std::lock_guard<std::mutex> lock(storageMtx);
+        storageCv.notify_one();
+    }
+}
+
+// Разбирает очереди всех датчиков пачками: проверка, спул, кольцо в памяти, лог
+void storageThread() {
+    while (true) {
+        size_t processed = 0;
+        for (auto& sensor : sensors) {
+            processed += sensor.queue->consumeBatch(
+                [&](const ReceivedLine& line) { processLine(sensor, line); }, INGEST_BATCH);
+
+            uint64_t dropped = sensor.queue->dropped();
+            if (dropped != sensor.reportedDrops) {
+                std::cerr << "[Serial] Sensor " << sensor.id << " ingest queue overflow, dropped "
+                          << (dropped - sensor.reportedDrops) << " line(s)\n";
+                sensor.reportedDrops = dropped;
             }
+        }
+        // Окна закрываются по часам, даже если датчик молчит
+        time_t now = std::time(nullptr);
+        for (auto& sensor : sensors) {
+            sensor.hourlyWindows->advance(now);
+            sensor.dailyWindows->advance(now);
+        }
+        if (processed > 0) continue;
 
-            if (saveMeasurementToDB(temp)) {
-                std::cout << "[DB] Saved: " << temp << " C\n";
+        std::unique_lock<std::mutex> lock(storageMtx);
+        storageIdle = true;
+        bool pending = false;
+        for (const auto& sensor : sensors) pending = pending || !sensor.queue->empty();
+        // Таймаут — страховка: потери учитываются и без новых строк
+        if (!pending) storageCv.wait_for(lock, std::chrono::milliseconds(200));
+        storageIdle = false;
+    }
+}
+
+bool openSensorPort(SensorChannel& sensor) {
+    try {
+        sensor.port = std::make_unique<SerialPort>(sensor.portName, serialConfig);
+        sensor.online = true;
+        std::cout << "[Serial] Sensor " << sensor.id << " listening on " << sensor.portName << "\n";
+        if (!captureDir.empty()) {
+            std::string path = captureDir + "/sensor-" + std::to_string(sensor.id) + ".cap";
+            if (sensor.port->startCapture(path)) {
+                std::cout << "[Serial] Sensor " << sensor.id << " capturing to " << path << "\n";
+            } else {
+                std::cerr << "[Serial] Sensor " << sensor.id << " cannot create capture " << path << "\n";
             }
+        }
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "[Serial] Sensor " << sensor.id << " error: " << e.what() << "\n";
+        return false;
+    }
+}
+
+#ifdef __linux__
+// Все порты обслуживает один поток: epoll говорит, где есть данные, и мы
+// забираем их блоком, не блокируясь на отдельном устройстве
+void ingestThread() {
+    int epfd = epoll_create1(0);
+    if (epfd < 0) {
+        std::cerr << "[Serial] epoll_create1 failed\n";
+        return;
+    }
 
-            totalMeasurements++;
-            hourlyBuffer.push_back(temp);
-
-            if (hourlyBuffer.size() >= 60) {
-                float sum = 0.0f;
-                for (float t : hourlyBuffer) sum += t;
-                float avg = sum / static_cast<float>(hourlyBuffer.size());
-                std::cout << "[Hourly avg] " << avg << " C\n";
-
-                static int hourlyBlocks = 0;
-                hourlyBlocks++;
-                if (hourlyBlocks >= 24) {
-                    std::cout << "[Daily avg] " << avg << " C\n";
-                    hourlyBlocks = 0;
-                }
-                hourlyBuffer.clear();
+    size_t active = 0;
+    for (size_t i = 0; i < sensors.size(); ++i) {
+        if (!openSensorPort(sensors[i])) continue;
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.u32 = static_cast<uint32_t>(i);
+        if (epoll_ctl(epfd, EPOLL_CTL_ADD, sensors[i].port->nativeHandle(), &ev) != 0) {
+            std::cerr << "[Serial] epoll_ctl failed for " << sensors[i].portName << "\n";
+            continue;
+        }
+        active++;
+    }
+
+    epoll_event events[64];
+    std::vector<std::string> lines;
+    while (active > 0) {
+        int n = epoll_wait(epfd, events, 64, 2000);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "[Serial] epoll_wait failed\n";
+            break;
+        }
+        for (int i = 0; i < n; ++i) {
+            SensorChannel& sensor = sensors[events[i].data.u32];
+            lines.clear();
+            if (sensor.port->readLines(lines) > 0) {
+                enqueueLines(sensor, lines);
+            } else if (events[i].events & (EPOLLHUP | EPOLLERR)) {
+                // Передающая сторона закрылась — убираем порт, иначе epoll будет будить нас вечно
+                epoll_ctl(epfd, EPOLL_CTL_DEL, sensor.port->nativeHandle(), nullptr);
+                std::cerr << "[Serial] Sensor " << sensor.id << " disconnected (" << sensor.portName << ")\n";
+                sensor.online = false;
+                sensor.port.reset();
+                active--;
             }
         }
+    }
+    close(epfd);
+}
+#else
+// Без epoll каждому порту достаётся свой поток, ждущий строки в readLines
+void sensorReaderThread(SensorChannel* sensor) {
+    std::vector<std::string> lines;
+    try {
+        while (true) {
+            lines.clear();
+            if (sensor->port->readLines(lines, 2000) > 0) enqueueLines(*sensor, lines);
+        }
     } catch (const std::exception& e) {
-        std::cerr << "[Serial] Error: " << e.what() << "\n";
+        sensor->online = false;
+        std::cerr << "[Serial] Sensor " << sensor->id << " error: " << e.what() << "\n";
+    }
+}
+
+void ingestThread() {
+    std::vector<std::thread> readers;
+    for (auto& sensor : sensors) {
+        if (openSensorPort(sensor)) {
+            readers.emplace_back(sensorReaderThread, &sensor);
+        }
     }
+    for (auto& t : readers) t.join();
 }
+#endif
 
 // URL & HTTP 
 
@@ -311,17 +760,31 @@ void handleRequest(SOCKET clientSocket, const std::string& request) {
             return;
         }
         contentType = "text/html";
-    } else if (path == "/current") {
-        response = getLastMeasurementJSON();
+    } else if (path == "/sensors") {
+        response = getSensorsJSON();
         contentType = "application/json";
-    } else if (path == "/history") {
+    } else if (path == "/current") {
+        std::map<std::string, std::string> params;
+        parseQuery(query, params);
+        try {
+            int sensorId = params.count("sensor") ? std::stoi(params["sensor"]) : 0;
+            response = getLastMeasurementJSON(sensorId);
+            contentType = "application/json";
+        } catch (...) {
+            response = "HTTP/1.1 400 Bad Request\r\n\r\nInvalid sensor";
+            send(clientSocket, response.c_str(), response.length(), 0);
+            return;
+        }
+    } else if (path == "/history" || path == "/stats") {
         std::map<std::string, std::string> params;
         parseQuery(query, params);
         if (params.count("start") && params.count("end")) {
             try {
                 time_t start = std::stoll(params["start"]);
                 time_t end = std::stoll(params["end"]);
-                response = buildHistoryJSON(start, end);
+                int sensorId = params.count("sensor") ? std::stoi(params["sensor"]) : 0;
+                response = path == "/history" ? buildHistoryJSON(sensorId, start, end)
+                                              : buildStatsJSON(sensorId, start, end);
                 contentType = "application/json";
             } catch (...) {
                 response = "HTTP/1.1 400 Bad Request\r\n\r\nInvalid timestamps";
@@ -333,6 +796,42 @@ void handleRequest(SOCKET clientSocket, const std::string& request) {
             send(clientSocket, response.c_str(), response.length(), 0);
             return;
         }
+    } else if (path == "/quantiles") {
+        std::map<std::string, std::string> params;
+        parseQuery(query, params);
+        if (!params.count("start") || !params.count("end")) {
+            response = "HTTP/1.1 400 Bad Request\r\n\r\nMissing start or end parameter";
+            send(clientSocket, response.c_str(), response.length(), 0);
+            return;
+        }
+        try {
+            time_t start = std::stoll(params["start"]);
+            time_t end = std::stoll(params["end"]);
+            int sensorId = params.count("sensor") ? std::stoi(params["sensor"]) : 0;
+            std::vector<double> qs;
+            if (!parseQuantiles(params.count("q") ? params["q"] : "0.5,0.95,0.99", qs)) {
+                throw std::invalid_argument("q");
+            }
+            response = buildQuantilesJSON(sensorId, start, end, qs);
+            contentType = "application/json";
+        } catch (...) {
+            response = "HTTP/1.1 400 Bad Request\r\n\r\nInvalid parameters";
+            send(clientSocket, response.c_str(), response.length(), 0);
+            return;
+        }
+    } else if (path == "/admin/snapshot") {
+        std::string target;
+        if (!snapshots->start(target)) {
+            int remaining = 0, total = 0;
+            snapshots->progress(remaining, total);
+            response = "HTTP/1.1 409 Conflict\r\nContent-Type: application/json\r\n\r\n"
+                       "{\"status\":\"running\",\"remaining\":" + std::to_string(remaining) +
+                       ",\"total\":" + std::to_string(total) + "}";
+            send(clientSocket, response.c_str(), response.length(), 0);
+            return;
+        }
+        response = "{\"status\":\"started\",\"path\":\"" + target + "\"}";
+        contentType = "application/json";
     } else {
         response = "HTTP/1.1 404 Not Found\r\n\r\n";
         send(clientSocket, response.c_str(), response.length(), 0);
@@ -408,14 +907,134 @@ void httpServerThread() {
 #endif
 }
 
+#ifndef _WIN32
+// SIGUSR1 заблокирован во всех потоках и принимается здесь через sigwait,
+// поэтому снимок запускается из обычного потока, а не из обработчика сигнала
+void snapshotSignalThread(sigset_t signals) {
+    while (true) {
+        int sig = 0;
+        if (sigwait(&signals, &sig) != 0) continue;
+        std::string target;
+        if (!snapshots->start(target)) {
+            std::cout << "[Backup] Snapshot already in progress\n";
+        }
+    }
+}
+#endif
+
 // MAIN 
 
-int main() {
-    if (!initDatabase()) {
+int main(int argc, char* argv[]) {
+    std::vector<std::string> portNames;
+    std::string snapshotDir = ".";
+    std::string spoolDir = "spool";
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--port" && i + 1 < argc) {
+            portNames.push_back(argv[++i]);
+        } else if (arg == "--hot-hours" && i + 1 < argc) {
+            hotTierHours = std::atoi(argv[++i]);
+        } else if (arg == "--hot-capacity" && i + 1 < argc) {
+            hotTierCapacity = static_cast<size_t>(std::strtoull(argv[++i], nullptr, 10));
+        } else if (arg == "--snapshot-dir" && i + 1 < argc) {
+            snapshotDir = argv[++i];
+        } else if (arg == "--spool-dir" && i + 1 < argc) {
+            spoolDir = argv[++i];
+        } else if (arg == "--baud" && i + 1 < argc) {
+            serialConfig.baudRate = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--framing" && i + 1 < argc && parseFraming(argv[i + 1], serialConfig)) {
+            ++i;
+        } else if (arg == "--flow" && i + 1 < argc && parseFlowControl(argv[i + 1], serialConfig)) {
+            ++i;
+        } else if (arg == "--capture-dir" && i + 1 < argc) {
+            captureDir = argv[++i];
+        } else {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--port PATH]... [--hot-hours N] [--hot-capacity N] [--snapshot-dir DIR] [--spool-dir DIR]\n"
+                      << "       [--baud N] [--framing 8N1] [--flow none|rtscts|xonxoff] [--capture-dir DIR]\n";
+            return 1;
+        }
+    }
+
+    if (hotTierHours <= 0) {
+        std::cerr << "--hot-hours must be positive\n";
+        return 1;
+    }
+
+    if (!initDatabase(DB_PATH)) {
+        return 1;
+    }
+
+    uint64_t spoolApplied = 0;
+    if (!readSpoolPosition(DB_PATH, spoolApplied)) {
         return 1;
     }
+    spool = std::make_unique<IngestSpool>(spoolDir);
+    if (!spool->open(spoolApplied)) {
+        return 1;
+    }
+    spool->start(saveMeasurementsToDB);
+    // Остаток спула с прошлого запуска даём перенести в БД, но недолго: если база
+    // занята или недоступна, приём не должен её ждать. Кольца всё равно берут
+    // недостающее из спула (warmHotTier)
+    auto drainDeadline = std::chrono::steady_clock::now() + std::chrono::seconds(SPOOL_DRAIN_TIMEOUT_SEC);
+    while (spool->backlog() > 0 && std::chrono::steady_clock::now() < drainDeadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    if (uint64_t left = spool->backlog()) {
+        std::cerr << "[Spool] " << left << " measurements still not in DB after " << SPOOL_DRAIN_TIMEOUT_SEC
+                  << " s, starting anyway; they stay in the spool\n";
+    }
+
+    if (portNames.empty()) {
+        portNames.push_back(
+#ifdef _WIN32
+            "COM5"
+#else
+            "/dev/pts/1"
+#endif
+        );
+    }
+
+    time_t horizon = static_cast<time_t>(hotTierHours) * 3600;
+    size_t capacity = hotTierCapacity ? hotTierCapacity : static_cast<size_t>(horizon);
+    // Не resize: SensorChannel с atomic не перемещается
+    sensors = std::vector<SensorChannel>(portNames.size());
+    for (size_t i = 0; i < portNames.size(); ++i) {
+        sensors[i].id = static_cast<int>(i);
+        sensors[i].portName = portNames[i];
+        sensors[i].hotTier = std::make_unique<HotTier>(horizon, capacity);
+        sensors[i].queue = std::make_unique<IngestQueue>();
+
+        // Сутки начинаются в местную полночь (и после перевода часов);
+        // опоздавшим значениям даём WINDOW_LATENESS секунд
+        int id = sensors[i].id;
+        sensors[i].hourlyWindows = std::make_unique<WindowAggregator>(WindowAggregator::localTime(3600, WINDOW_LATENESS,
+            [id](const WindowStats& w) {
+                saveAverageToDB("hourly_averages", id, w.start, w.stats.mean);
+                std::cout << "[Hourly avg] Sensor " << id << ": " << w.stats.mean << " C (min " << w.stats.min
+                          << ", max " << w.stats.max << ", stddev " << w.stats.stddev() << ")\n";
+            }));
+        sensors[i].dailyWindows = std::make_unique<WindowAggregator>(WindowAggregator::localTime(24 * 3600, WINDOW_LATENESS,
+            [id](const WindowStats& w) {
+                saveAverageToDB("daily_averages", id, w.start, w.stats.mean);
+                std::cout << "[Daily avg] Sensor " << id << ": " << w.stats.mean << " C\n";
+            }));
+        warmHotTier(sensors[i], spoolApplied);
+    }
+
+    snapshots = std::make_unique<SnapshotManager>(DB_PATH, snapshotDir);
+#ifndef _WIN32
+    // Маска наследуется всеми потоками, созданными ниже
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGUSR1);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+    std::thread(snapshotSignalThread, signals).detach();
+#endif
 
-    std::thread serialThread(serialReaderThread);
+    std::thread(storageThread).detach();
+    std::thread serialThread(ingestThread);
     httpServerThread();
 
     serialThread.join();
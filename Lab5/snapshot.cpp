@@ -0,0 +1,102 @@
+#include "snapshot.h"
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <iostream>
+#include <utility>
+#include <sqlite3.h>
+
+SnapshotManager::SnapshotManager(std::string dbPath, std::string directory)
+    : dbPath_(std::move(dbPath)), directory_(std::move(directory)) {}
+
+SnapshotManager::~SnapshotManager() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (worker_.joinable()) worker_.join();
+}
+
+bool SnapshotManager::start(std::string& target) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (running_) return false;
+    if (worker_.joinable()) worker_.join();  // предыдущий снимок уже завершён
+
+    time_t now = std::time(nullptr);
+    char name[64];
+    std::strftime(name, sizeof(name), "temperature-%Y%m%d-%H%M%S.db", std::localtime(&now));
+    target = directory_.empty() ? name : directory_ + "/" + name;
+
+    running_ = true;
+    remaining_ = 0;
+    total_ = 0;
+    worker_ = std::thread(&SnapshotManager::run, this, target);
+    return true;
+}
+
+void SnapshotManager::progress(int& remaining, int& total) const {
+    remaining = remaining_;
+    total = total_;
+}
+
+void SnapshotManager::run(std::string target) {
+    auto started = std::chrono::steady_clock::now();
+    // Пишем во временный файл и переименовываем в конце: недописанный снимок
+    // никогда не лежит под итоговым именем
+    std::string partial = target + ".part";
+    std::remove(partial.c_str());
+
+    sqlite3* src = nullptr;
+    sqlite3* dst = nullptr;
+    bool ok = sqlite3_open_v2(dbPath_.c_str(), &src, SQLITE_OPEN_READONLY, nullptr) == SQLITE_OK &&
+              sqlite3_open(partial.c_str(), &dst) == SQLITE_OK;
+    if (ok) {
+        sqlite3_busy_timeout(src, 5000);
+        // Читающая транзакция открывается первым SELECT и держится до конца копирования
+        ok = sqlite3_exec(src, "BEGIN; SELECT COUNT(*) FROM sqlite_master;", nullptr, nullptr, nullptr) == SQLITE_OK;
+    }
+
+    sqlite3_backup* backup = ok ? sqlite3_backup_init(dst, "main", src, "main") : nullptr;
+    if (!backup) {
+        std::cerr << "[Backup] Cannot start snapshot: " << sqlite3_errmsg(dst ? dst : src) << "\n";
+        ok = false;
+    } else {
+        std::cout << "[Backup] Snapshot started: " << target << "\n";
+        int lastReported = -1;
+        while (true) {
+            int rc = sqlite3_backup_step(backup, SNAPSHOT_PAGES_PER_STEP);
+            int total = sqlite3_backup_pagecount(backup);
+            int remaining = sqlite3_backup_remaining(backup);
+            total_ = total;
+            remaining_ = remaining;
+
+            if (rc == SQLITE_DONE) break;
+            if (rc != SQLITE_OK && rc != SQLITE_BUSY && rc != SQLITE_LOCKED) {
+                std::cerr << "[Backup] Snapshot failed: " << sqlite3_errstr(rc) << "\n";
+                ok = false;
+                break;
+            }
+
+            // Прогресс в лог — каждые 10%
+            int percent = total > 0 ? static_cast<int>((total - remaining) * 100LL / total) : 0;
+            if (percent / 10 != lastReported) {
+                lastReported = percent / 10;
+                std::cout << "[Backup] " << percent << "% (" << (total - remaining) << "/" << total << " pages)\n";
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(SNAPSHOT_STEP_PAUSE_MS));
+        }
+        if (sqlite3_backup_finish(backup) != SQLITE_OK) ok = false;
+    }
+
+    if (src) {
+        sqlite3_exec(src, "COMMIT;", nullptr, nullptr, nullptr);
+        sqlite3_close(src);
+    }
+    if (dst) sqlite3_close(dst);
+
+    if (ok && std::rename(partial.c_str(), target.c_str()) == 0) {
+        double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        std::cout << "[Backup] Snapshot written to " << target << " (" << total_ << " pages, " << secs << " s)\n";
+    } else {
+        std::remove(partial.c_str());
+        std::cerr << "[Backup] Snapshot " << target << " not created\n";
+    }
+    running_ = false;
+}
@@ -0,0 +1,46 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Онлайн-снимки базы через sqlite3_backup. Копирование идёт в фоновом потоке
+// по SNAPSHOT_PAGES_PER_STEP страниц с паузой SNAPSHOT_STEP_PAUSE_MS между шагами,
+// так что запись измерений и запросы не останавливаются.
+// На время копирования держится читающая транзакция: в режиме WAL она фиксирует
+// согласованное состояние базы, и новые записи не заставляют копирование начинаться заново.
+const int SNAPSHOT_PAGES_PER_STEP = 64;
+const int SNAPSHOT_STEP_PAUSE_MS = 20;
+
+class SnapshotManager {
+public:
+    SnapshotManager(std::string dbPath, std::string directory);
+    ~SnapshotManager();
+
+    SnapshotManager(const SnapshotManager&) = delete;
+    SnapshotManager& operator=(const SnapshotManager&) = delete;
+
+    // Запускает снимок в фоне. Возвращает false, если предыдущий ещё не закончен.
+    // В target — путь файла, в который будет записан снимок
+    bool start(std::string& target);
+
+    bool running() const { return running_; }
+
+    // Сколько страниц осталось и сколько всего (0/0, пока копирование не началось)
+    void progress(int& remaining, int& total) const;
+
+private:
+    void run(std::string target);
+
+    std::string dbPath_;
+    std::string directory_;
+    std::mutex mtx_;
+    std::thread worker_;
+    std::atomic<bool> running_{false};
+    std::atomic<int> remaining_{0};
+    std::atomic<int> total_{0};
+};
+
+#endif // SNAPSHOT_H
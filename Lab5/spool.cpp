@@ -0,0 +1,362 @@
+#include "spool.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <utility>
+
+#ifdef _WIN32
+    #include <io.h>
+    #define spool_fsync _commit
+    #define spool_dup _dup
+    #define spool_close _close
+    #define spool_fileno _fileno
+#else
+    #include <unistd.h>
+    #define spool_fsync fsync
+    #define spool_dup dup
+    #define spool_close close
+    #define spool_fileno fileno
+#endif
+
+namespace fs = std::filesystem;
+
+// Запись на диске: crc32 | seq | sensor_id | timestamp | value.
+// crc считается по всем полям после себя
+static const size_t RECORD_SIZE = 4 + 8 + 4 + 8 + 4;
+
+static uint32_t crc32(const unsigned char* data, size_t size) {
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> t{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[i] = c;
+        }
+        return t;
+    }();
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; ++i) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return crc ^ 0xFFFFFFFFu;
+}
+
+static void encodeRecord(const SpoolRecord& r, unsigned char* out) {
+    int32_t sensor = r.sensorId;
+    std::memcpy(out + 4, &r.seq, 8);
+    std::memcpy(out + 12, &sensor, 4);
+    std::memcpy(out + 16, &r.timestamp, 8);
+    std::memcpy(out + 24, &r.value, 4);
+    uint32_t crc = crc32(out + 4, RECORD_SIZE - 4);
+    std::memcpy(out, &crc, 4);
+}
+
+static bool decodeRecord(const unsigned char* in, SpoolRecord& r) {
+    uint32_t crc;
+    std::memcpy(&crc, in, 4);
+    if (crc != crc32(in + 4, RECORD_SIZE - 4)) return false;
+    int32_t sensor;
+    std::memcpy(&r.seq, in + 4, 8);
+    std::memcpy(&sensor, in + 12, 4);
+    std::memcpy(&r.timestamp, in + 16, 8);
+    std::memcpy(&r.value, in + 24, 4);
+    r.sensorId = sensor;
+    return true;
+}
+
+IngestSpool::IngestSpool(std::string directory) : directory_(std::move(directory)) {}
+
+IngestSpool::~IngestSpool() {
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    if (syncThread_.joinable()) syncThread_.join();
+    if (replayThread_.joinable()) replayThread_.join();
+    if (out_) {
+        std::fflush(out_);
+        spool_fsync(spool_fileno(out_));
+        std::fclose(out_);
+    }
+}
+
+bool IngestSpool::scanSegment(Segment& segment, bool active) {
+    std::FILE* f = std::fopen(segment.path.c_str(), "rb");
+    if (!f) return false;
+
+    // Испорченная запись в середине не обрывает сегмент: следующие за ней целы,
+    // перенос пропустит её и посчитает в corrupted()
+    unsigned char buf[RECORD_SIZE];
+    uint64_t prev = segment.firstSeq - 1;
+    size_t offset = 0;
+    size_t validEnd = 0;
+    SpoolRecord r;
+    while (std::fread(buf, 1, RECORD_SIZE, f) == RECORD_SIZE) {
+        offset += RECORD_SIZE;
+        if (!decodeRecord(buf, r) || r.seq <= prev) continue;
+        prev = r.seq;
+        segment.lastSeq = r.seq;
+        validEnd = offset;
+    }
+    std::fclose(f);
+
+    // Недописанный при падении хвост бывает только у сегмента, куда шла запись:
+    // неполная запись или испорченные записи после последней целой.
+    // Закрытые сегменты не трогаем, неполную запись в конце просто не читаем
+    if (!active) {
+        segment.size = offset;
+        return true;
+    }
+    std::error_code ec;
+    if (fs::file_size(segment.path, ec) != validEnd && !ec) {
+        std::cerr << "[Spool] Truncating torn tail of " << segment.path << " at " << validEnd << " bytes\n";
+        fs::resize_file(segment.path, validEnd, ec);
+    }
+    segment.size = validEnd;
+    return !ec;
+}
+
+bool IngestSpool::open(uint64_t lastApplied) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    std::error_code ec;
+    fs::create_directories(directory_, ec);
+    if (ec) {
+        std::cerr << "[Spool] Cannot create " << directory_ << ": " << ec.message() << "\n";
+        return false;
+    }
+
+    for (const auto& entry : fs::directory_iterator(directory_, ec)) {
+        std::string name = entry.path().filename().string();
+        if (name.size() != 30 || name.compare(0, 6, "spool-") != 0 || name.compare(26, 4, ".log") != 0) continue;
+        Segment segment;
+        segment.firstSeq = std::strtoull(name.c_str() + 6, nullptr, 10);
+        segment.path = entry.path().string();
+        segments_.push_back(segment);
+    }
+    std::sort(segments_.begin(), segments_.end(),
+              [](const Segment& a, const Segment& b) { return a.firstSeq < b.firstSeq; });
+
+    uint64_t maxSeq = lastApplied;
+    for (auto& segment : segments_) {
+        if (!scanSegment(segment, &segment == &segments_.back())) {
+            std::cerr << "[Spool] Cannot read " << segment.path << "\n";
+            return false;
+        }
+        maxSeq = std::max(maxSeq, segment.lastSeq);
+    }
+
+    // Сегменты, уже целиком лежащие в БД, больше не нужны
+    while (!segments_.empty() && segments_.front().lastSeq <= lastApplied) {
+        fs::remove(segments_.front().path, ec);
+        segments_.pop_front();
+    }
+
+    appliedSeq_ = lastApplied;
+    nextSeq_ = maxSeq + 1;
+    if (maxSeq > lastApplied) {
+        std::cout << "[Spool] " << (maxSeq - lastApplied) << " measurements to replay after restart\n";
+    }
+    return true;
+}
+
+bool IngestSpool::rollSegment() {
+    if (out_) {
+        std::fflush(out_);
+        spool_fsync(spool_fileno(out_));
+        std::fclose(out_);
+        out_ = nullptr;
+    }
+
+    // Сегмент, в который ещё ничего не записано, открываем повторно, а не заводим новый
+    if (!segments_.empty() && segments_.back().firstSeq == nextSeq_) {
+        out_ = std::fopen(segments_.back().path.c_str(), "ab");
+        return out_ != nullptr;
+    }
+
+    char name[32];
+    std::snprintf(name, sizeof(name), "spool-%020llu.log", static_cast<unsigned long long>(nextSeq_));
+    Segment segment;
+    segment.firstSeq = nextSeq_;
+    segment.path = (fs::path(directory_) / name).string();
+    out_ = std::fopen(segment.path.c_str(), "ab");
+    if (!out_) {
+        std::cerr << "[Spool] Cannot create " << segment.path << "\n";
+        return false;
+    }
+    segments_.push_back(segment);
+    return true;
+}
+
+bool IngestSpool::append(int sensorId, time_t ts, float value) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (!out_ || segments_.empty() || segments_.back().size >= SPOOL_SEGMENT_BYTES) {
+        if (!rollSegment()) return false;
+    }
+
+    SpoolRecord r;
+    r.seq = nextSeq_;
+    r.sensorId = sensorId;
+    r.timestamp = static_cast<int64_t>(ts);
+    r.value = value;
+    unsigned char buf[RECORD_SIZE];
+    encodeRecord(r, buf);
+
+    // fflush отдаёт запись ядру: после него она переживает падение процесса,
+    // до диска её донесёт ближайший fsync в syncLoop
+    if (std::fwrite(buf, 1, RECORD_SIZE, out_) != RECORD_SIZE || std::fflush(out_) != 0) {
+        std::cerr << "[Spool] Write failed\n";
+        // Отрезаем недописанную запись; следующий append откроет сегмент заново
+        std::fclose(out_);
+        out_ = nullptr;
+        std::error_code ec;
+        fs::resize_file(segments_.back().path, segments_.back().size, ec);
+        return false;
+    }
+
+    Segment& active = segments_.back();
+    active.size += RECORD_SIZE;
+    active.lastSeq = nextSeq_;
+    nextSeq_++;
+    dirty_ = true;
+    cv_.notify_all();
+    return true;
+}
+
+void IngestSpool::start(ApplyFn apply) {
+    apply_ = std::move(apply);
+    syncThread_ = std::thread(&IngestSpool::syncLoop, this);
+    replayThread_ = std::thread(&IngestSpool::replayLoop, this);
+}
+
+uint64_t IngestSpool::backlog() const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return nextSeq_ - 1 - appliedSeq_;
+}
+
+uint64_t IngestSpool::corrupted() const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return corrupted_;
+}
+
+bool IngestSpool::pending(uint64_t afterSeq, const std::function<void(const SpoolRecord&)>& fn) const {
+    std::vector<Segment> segments;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (afterSeq + 1 >= nextSeq_) return true;
+        if (segments_.empty() || segments_.front().firstSeq > afterSeq + 1) return false;
+        segments.assign(segments_.begin(), segments_.end());
+    }
+
+    // Файлы читаем без блокировки: перенос может удалить сегмент, тогда fopen не откроет его
+    std::vector<unsigned char> raw;
+    for (const Segment& segment : segments) {
+        if (segment.lastSeq != 0 && segment.lastSeq <= afterSeq) continue;
+        raw.resize(segment.size);
+        std::FILE* f = std::fopen(segment.path.c_str(), "rb");
+        bool readOk = f && std::fread(raw.data(), 1, raw.size(), f) == raw.size();
+        if (f) std::fclose(f);
+        if (!readOk) return false;
+        for (size_t offset = 0; offset + RECORD_SIZE <= raw.size(); offset += RECORD_SIZE) {
+            SpoolRecord r;
+            if (decodeRecord(raw.data() + offset, r) && r.seq > afterSeq) fn(r);
+        }
+    }
+    return true;
+}
+
+void IngestSpool::syncLoop() {
+    while (true) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(SPOOL_SYNC_INTERVAL_MS));
+        int fd = -1;
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            if (stop_) return;
+            if (!dirty_ || !out_) continue;
+            // Копия дескриптора: сегмент может закрыться, пока идёт fsync
+            fd = spool_dup(spool_fileno(out_));
+            dirty_ = false;
+        }
+        if (fd >= 0) {
+            spool_fsync(fd);
+            spool_close(fd);
+        }
+    }
+}
+
+void IngestSpool::replayLoop() {
+    size_t readOffset = 0;  // позиция чтения в первом сегменте
+    std::vector<unsigned char> raw;
+    std::vector<SpoolRecord> batch;
+
+    while (true) {
+        Segment front;
+        bool sealed = false;
+        uint64_t applied = 0;
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            cv_.wait(lock, [&] {
+                return stop_ || (!segments_.empty() && (segments_.front().size > readOffset || segments_.size() > 1));
+            });
+            if (stop_) return;
+            front = segments_.front();
+            sealed = segments_.size() > 1;
+            applied = appliedSeq_;
+        }
+
+        if (sealed && readOffset >= front.size) {
+            // Прочитанный до конца закрытый сегмент удаляем
+            std::lock_guard<std::mutex> lock(mtx_);
+            std::error_code ec;
+            fs::remove(front.path, ec);
+            segments_.pop_front();
+            readOffset = 0;
+            continue;
+        }
+
+        size_t count = std::min(SPOOL_REPLAY_BATCH, (front.size - readOffset) / RECORD_SIZE);
+        raw.resize(count * RECORD_SIZE);
+        std::FILE* f = std::fopen(front.path.c_str(), "rb");
+        bool readOk = f && std::fseek(f, static_cast<long>(readOffset), SEEK_SET) == 0 &&
+                      std::fread(raw.data(), 1, raw.size(), f) == raw.size();
+        if (f) std::fclose(f);
+        if (!readOk) {
+            std::cerr << "[Spool] Cannot read " << front.path << "\n";
+            std::this_thread::sleep_for(std::chrono::milliseconds(SPOOL_RETRY_MS));
+            continue;
+        }
+
+        batch.clear();
+        uint64_t lastSeq = applied;
+        size_t corrupted = 0;
+        for (size_t i = 0; i < count; ++i) {
+            SpoolRecord r;
+            if (!decodeRecord(raw.data() + i * RECORD_SIZE, r)) {
+                corrupted++;
+                continue;
+            }
+            lastSeq = std::max(lastSeq, r.seq);
+            if (r.seq > applied) batch.push_back(r);  // записанное до сбоя пропускаем
+        }
+        if (corrupted > 0) {
+            // Испорченная на диске запись в БД уже не попадёт
+            std::cerr << "[Spool] Skipped " << corrupted << " record(s) with bad CRC in " << front.path
+                      << " at offset " << readOffset << "\n";
+            std::lock_guard<std::mutex> lock(mtx_);
+            corrupted_ += corrupted;
+        }
+
+        // База занята или недоступна — ждём и повторяем ту же пачку, данные остаются в спуле
+        while (!batch.empty() && !apply_(batch)) {
+            std::cerr << "[Spool] DB write failed, " << batch.size() << " measurements kept for retry\n";
+            std::this_thread::sleep_for(std::chrono::milliseconds(SPOOL_RETRY_MS));
+            std::lock_guard<std::mutex> lock(mtx_);
+            if (stop_) return;
+        }
+
+        std::lock_guard<std::mutex> lock(mtx_);
+        appliedSeq_ = lastSeq;
+        readOffset += count * RECORD_SIZE;
+    }
+}
@@ -0,0 +1,95 @@
+#ifndef SPOOL_H
+#define SPOOL_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Одно измерение в спуле. seq растёт монотонно и переживает перезапуски
+struct SpoolRecord {
+    uint64_t seq = 0;
+    int sensorId = 0;
+    int64_t timestamp = 0;
+    float value = 0.0f;
+};
+
+// Журнал измерений между приёмом с порта и записью в SQLite.
+// Записи дописываются в сегменты spool-<first seq>.log фиксированного размера
+// с CRC32; fsync выполняется пачкой раз в SPOOL_SYNC_INTERVAL_MS, так что приём
+// не ждёт ни диска, ни базы. Отдельный поток переносит записи в БД; функция
+// apply обязана в той же транзакции сохранить seq последней записи, тогда
+// повторный перенос после сбоя пропускает уже записанное.
+const size_t SPOOL_SEGMENT_BYTES = 1 << 20;
+const int SPOOL_SYNC_INTERVAL_MS = 50;
+const size_t SPOOL_REPLAY_BATCH = 512;
+const int SPOOL_RETRY_MS = 500;
+
+class IngestSpool {
+public:
+    using ApplyFn = std::function<bool(const std::vector<SpoolRecord>&)>;
+
+    explicit IngestSpool(std::string directory);
+    ~IngestSpool();
+
+    IngestSpool(const IngestSpool&) = delete;
+    IngestSpool& operator=(const IngestSpool&) = delete;
+
+    // Читает существующие сегменты, отрезает недописанный хвост и удаляет
+    // сегменты, целиком перенесённые в БД (lastApplied — seq из БД)
+    bool open(uint64_t lastApplied);
+
+    // Дописывает измерение. После возврата true оно переживёт падение процесса
+    bool append(int sensorId, time_t ts, float value);
+
+    // Запускает потоки fsync и переноса в БД
+    void start(ApplyFn apply);
+
+    // Сколько записей ещё не перенесено в БД
+    uint64_t backlog() const;
+
+    // Сколько записей перенос пропустил из-за неверной CRC
+    uint64_t corrupted() const;
+
+    // Передаёт в fn записи с seq > afterSeq, ещё лежащие в спуле. false — часть
+    // из них успели перенести в БД и удалить из спула: их надо перечитать из БД
+    bool pending(uint64_t afterSeq, const std::function<void(const SpoolRecord&)>& fn) const;
+
+private:
+    struct Segment {
+        uint64_t firstSeq = 0;
+        uint64_t lastSeq = 0;   // 0 — сегмент пуст
+        std::string path;
+        size_t size = 0;
+    };
+
+    // active — последний сегмент: только у него отрезается недописанный хвост
+    bool scanSegment(Segment& segment, bool active);
+    bool rollSegment();
+    void syncLoop();
+    void replayLoop();
+
+    std::string directory_;
+    ApplyFn apply_;
+
+    mutable std::mutex mtx_;
+    std::condition_variable cv_;
+    std::deque<Segment> segments_;
+    std::FILE* out_ = nullptr;
+    uint64_t nextSeq_ = 1;
+    uint64_t appliedSeq_ = 0;
+    uint64_t corrupted_ = 0;
+    bool dirty_ = false;
+    bool stop_ = false;
+
+    std::thread syncThread_;
+    std::thread replayThread_;
+};
+
+#endif // SPOOL_H
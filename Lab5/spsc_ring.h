@@ -0,0 +1,80 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+// Очередь фиксированной ёмкости между одним писателем и одним читателем без
+// блокировок. Индексы писателя и читателя лежат в разных строках кэша, и каждый
+// держит у себя копию чужого индекса: общая строка читается, только когда
+// по копии очередь выглядит полной (пустой). Слоты переиспользуются, поэтому
+// строки после первого круга не выделяют память заново.
+// Если очередь полна, элемент не ставится и учитывается в dropped().
+template <typename T, size_t Capacity>
+class SpscRing {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    SpscRing() = default;
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // Писатель. fill(T&) заполняет свободный слот; false — очередь полна
+    template <typename Fill>
+    bool tryPush(Fill&& fill) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - cachedHead_ == Capacity) {
+            cachedHead_ = head_.load(std::memory_order_acquire);
+            if (tail - cachedHead_ == Capacity) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+        }
+        fill(slots_[tail & (Capacity - 1)]);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Читатель. Передаёт в consume(T&) до maxItems элементов и освобождает их
+    // разом, одной записью индекса. Возвращает число обработанных элементов
+    template <typename Consume>
+    size_t consumeBatch(Consume&& consume, size_t maxItems = Capacity) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (cachedTail_ == head) {
+            cachedTail_ = tail_.load(std::memory_order_acquire);
+            if (cachedTail_ == head) return 0;
+        }
+        size_t count = cachedTail_ - head;
+        if (count > maxItems) count = maxItems;
+        for (size_t i = 0; i < count; ++i) consume(slots_[(head + i) & (Capacity - 1)]);
+        head_.store(head + count, std::memory_order_release);
+        return count;
+    }
+
+    bool empty() const {
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+    }
+
+    // Сколько элементов отброшено из-за переполнения за всё время
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+    static constexpr size_t capacity() { return Capacity; }
+
+private:
+    static const size_t CACHE_LINE = 64;
+
+    // Строка читателя
+    alignas(CACHE_LINE) std::atomic<size_t> head_{0};
+    size_t cachedTail_ = 0;
+    // Строка писателя
+    alignas(CACHE_LINE) std::atomic<size_t> tail_{0};
+    size_t cachedHead_ = 0;
+    std::atomic<uint64_t> dropped_{0};
+
+    alignas(CACHE_LINE) std::array<T, Capacity> slots_;
+};
+
+#endif // SPSC_RING_H
@@ -1,8 +1,8 @@
 #include "utils.h"
 #include <sstream>
 #include <iomanip>
-#include <cctype>
-#include <stdexcept>
+#include <cstring>
+#include <charconv>
 
 std::string roundToTenth(float value) {
     std::stringstream ss;
@@ -18,64 +18,164 @@ int calculateChecksum(const std::string& data) {
     return sum;
 }
 
-// Проверяет, что строка имеет формат: [-]ddd.d (ровно 1 цифра после точки)
-bool isValidTempFormat(const std::string& s) {
-    if (s.empty()) return false;
+bool validatePacket(const std::string& packet, float& outTemp) {
+    return validatePacket(std::string_view(packet), outTemp);
+}
 
-    size_t start = 0;
-    if (s[0] == '-') {
-        if (s.size() < 4) return false; // минимум "-0.0"
-        start = 1;
+// Один проход по "[-]ddd.d;checksum": формат, сумма кодов и значение считаются
+// вместе, без копий подстрок и исключений. Результат совпадает со старой
+// проверкой через substr/stof/stoi, включая её допущения в чексумме
+// (пробелы и знак перед числом, мусор после цифр).
+bool validatePacket(std::string_view packet, float& outTemp) noexcept {
+    const char* p = packet.data();
+    const char* end = p + packet.size();
+
+    int sum = 0;
+    bool negative = false;
+    if (p < end && *p == '-') {
+        negative = true;
+        sum += '-';
+        ++p;
     }
 
-    // Находим точку
-    size_t dotPos = s.find('.', start);
-    if (dotPos == std::string::npos) return false;
-    if (dotPos == start) return false; // нет цифр до точки (".5" — недопустимо)
-    if (dotPos + 2 != s.size()) return false; // должно быть ровно 1 символ после точки
+    // Целая часть: хотя бы одна цифра
+    const char* intBegin = p;
+    uint64_t mantissa = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+        sum += static_cast<unsigned char>(*p);
+        ++p;
+    }
+    size_t intDigits = static_cast<size_t>(p - intBegin);
+    if (intDigits == 0) return false;
+
+    // Ровно одна цифра после точки, сразу за ней ';' и непустая чексумма
+    if (end - p < 4 || p[0] != '.' || p[1] < '0' || p[1] > '9' || p[2] != ';') return false;
+    sum += '.' + static_cast<unsigned char>(p[1]);
+    mantissa = mantissa * 10 + static_cast<uint64_t>(p[1] - '0');
+    const char* tempEnd = p + 2;
 
-    // Проверяем: все до точки — цифры
-    for (size_t i = start; i < dotPos; ++i) {
-        if (!std::isdigit(static_cast<unsigned char>(s[i]))) {
-            return false;
+    // Для коротких чисел mantissa / 10 в double точна до округления во float;
+    // длинные (и выходящие за float) разбирает from_chars, как это делал stof
+    if (intDigits <= 15) {
+        double value = static_cast<double>(mantissa) / 10.0;
+        outTemp = static_cast<float>(negative ? -value : value);
+    } else {
+        float value;
+        auto res = std::from_chars(packet.data(), tempEnd, value);
+        if (res.ec != std::errc() || res.ptr != tempEnd) return false;
+        outTemp = value;
+    }
+
+    // Чексумма по правилам strtol: пробелы, знак, цифры, остальное игнорируется
+    p = tempEnd + 1;
+    while (p < end && (*p == ' ' || (*p >= '\t' && *p <= '\r'))) ++p;
+    bool received_negative = false;
+    if (p < end && (*p == '+' || *p == '-')) {
+        received_negative = *p == '-';
+        ++p;
+    }
+    if (p == end || *p < '0' || *p > '9') return false;
+    long long received = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        received = received * 10 + (*p - '0');
+        if (received > 0x7FFFFFFFLL + 1) return false;  // stoi бросил бы out_of_range
+        ++p;
+    }
+    if (received_negative) received = -received;
+    if (received > 0x7FFFFFFFLL) return false;
+    return received == sum;
+}
+
+uint16_t crc16(const uint8_t* data, size_t size) {
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < size; ++i) {
+        crc ^= static_cast<uint16_t>(data[i]) << 8;
+        for (int k = 0; k < 8; ++k) {
+            crc = (crc & 0x8000) ? static_cast<uint16_t>((crc << 1) ^ 0x1021) : static_cast<uint16_t>(crc << 1);
         }
     }
+    return crc;
+}
 
-    // Проверяем: один символ после точки — цифра
-    if (!std::isdigit(static_cast<unsigned char>(s[dotPos + 1]))) {
-        return false;
+std::string cobsEncode(const uint8_t* data, size_t size) {
+    std::string out;
+    out.reserve(size + size / 254 + 2);
+    size_t codePos = 0;
+    out.push_back(0);  // место под первый код
+    uint8_t code = 1;
+    for (size_t i = 0; i < size; ++i) {
+        if (data[i] == 0) {
+            out[codePos] = static_cast<char>(code);
+            codePos = out.size();
+            out.push_back(0);
+            code = 1;
+            continue;
+        }
+        out.push_back(static_cast<char>(data[i]));
+        if (++code == 0xFF) {
+            out[codePos] = static_cast<char>(code);
+            codePos = out.size();
+            out.push_back(0);
+            code = 1;
+        }
     }
+    out[codePos] = static_cast<char>(code);
+    return out;
+}
 
+bool cobsDecode(std::string_view encoded, std::vector<uint8_t>& out) {
+    out.clear();
+    size_t i = 0;
+    while (i < encoded.size()) {
+        uint8_t code = static_cast<uint8_t>(encoded[i]);
+        if (code == 0 || i + code > encoded.size()) return false;
+        for (size_t k = 1; k < code; ++k) {
+            out.push_back(static_cast<uint8_t>(encoded[i + k]));
+        }
+        i += code;
+        // Код 0xFF означает блок без нуля в конце; в конце кадра нуль не добавляется
+        if (code != 0xFF && i < encoded.size()) out.push_back(0);
+    }
     return true;
 }
 
-bool validatePacket(const std::string& packet, float& outTemp) {
-    size_t pos = packet.find(';');
-    if (pos == std::string::npos || pos == 0 || pos == packet.size() - 1) {
-        return false;
-    }
+std::string encodeBinaryPacket(const BinaryPacket& packet) {
+    size_t count = packet.samples.size() < BINARY_MAX_SAMPLES ? packet.samples.size() : BINARY_MAX_SAMPLES;
+    std::vector<uint8_t> raw;
+    raw.reserve(9 + count * 2 + 2);
+    auto put16 = [&raw](uint16_t v) {
+        raw.push_back(static_cast<uint8_t>(v & 0xFF));
+        raw.push_back(static_cast<uint8_t>(v >> 8));
+    };
+    put16(packet.sensorId);
+    put16(packet.seq);
+    put16(static_cast<uint16_t>(packet.deviceTimeMs & 0xFFFF));
+    put16(static_cast<uint16_t>(packet.deviceTimeMs >> 16));
+    raw.push_back(static_cast<uint8_t>(count));
+    for (size_t i = 0; i < count; ++i) put16(static_cast<uint16_t>(packet.samples[i]));
+    put16(crc16(raw.data(), raw.size()));
 
-    std::string tempStr = packet.substr(0, pos);
-    std::string chkStr = packet.substr(pos + 1);
+    std::string frame = cobsEncode(raw.data(), raw.size());
+    frame.push_back('\0');
+    return frame;
+}
 
-    // Проверка формата: только до десятых
-    if (!isValidTempFormat(tempStr)) {
-        return false;
-    }
+bool validatePacket(std::string_view frame, BinaryPacket& out) {
+    std::vector<uint8_t> raw;
+    if (!cobsDecode(frame, raw) || raw.size() < 11) return false;
 
-    // Преобразуем температуру
-    try {
-        outTemp = std::stof(tempStr);
-    } catch (...) {
-        return false;
-    }
+    auto get16 = [&raw](size_t pos) {
+        return static_cast<uint16_t>(raw[pos] | (raw[pos + 1] << 8));
+    };
+    size_t count = raw[8];
+    if (raw.size() != 9 + count * 2 + 2) return false;
+    if (get16(raw.size() - 2) != crc16(raw.data(), raw.size() - 2)) return false;
 
-    // Проверяем чексумму
-    int expected = calculateChecksum(tempStr);
-    try {
-        int received = std::stoi(chkStr);
-        return (received == expected);
-    } catch (...) {
-        return false;
-    }
-}
\ No newline at end of file
+    out.sensorId = get16(0);
+    out.seq = get16(2);
+    out.deviceTimeMs = static_cast<uint32_t>(get16(4)) | (static_cast<uint32_t>(get16(6)) << 16);
+    out.samples.resize(count);
+    for (size_t i = 0; i < count; ++i) out.samples[i] = static_cast<int16_t>(get16(9 + i * 2));
+    return true;
+}
@@ -0,0 +1,88 @@
+#ifndef WINDOW_AGG_H
+#define WINDOW_AGG_H
+
+#include <cstdint>
+#include <ctime>
+#include <deque>
+#include <functional>
+
+// Итоги по набору значений без хранения самих значений: count/sum/min/max и
+// дисперсия по Уэлфорду. Два набора сливаются без потери точности (формула Чана)
+struct RunningStats {
+    uint64_t count = 0;
+    double sum = 0.0;
+    double mean = 0.0;
+    double m2 = 0.0;   // сумма квадратов отклонений от среднего
+    double min = 0.0;
+    double max = 0.0;
+
+    void add(double value);
+    void merge(const RunningStats& other);
+    double variance() const { return count > 1 ? m2 / static_cast<double>(count - 1) : 0.0; }
+    double stddev() const;
+};
+
+// Закрытое окно: [start, end) и итоги по нему
+struct WindowStats {
+    time_t start = 0;
+    time_t end = 0;
+    RunningStats stats;
+};
+
+// Потоковая агрегация по окнам, выровненным по часам: окно длиной width
+// начинается в моменты, кратные slide (со сдвигом offset, например на часовой
+// пояс, чтобы сутки начинались в местную полночь). slide == width — смежные
+// окна (час, сутки), slide < width — скользящие (10 минут с шагом в минуту).
+//
+// Значения складываются в куски длиной slide; окно — слияние width/slide
+// кусков, так что память не зависит от числа значений. Окно закрывается, когда
+// время (по самому позднему значению или advance) уходит за его конец больше
+// чем на lateness. Значение, чьё первое окно уже закрыто, не учитывается и
+// считается в late(). Пустые окна не выдаются.
+//
+// Окна localTime() выровнены по местным часам: сдвиг берётся на момент каждой
+// границы, поэтому после перехода на летнее время и обратно сутки всё так же
+// начинаются в местную полночь (а сами длятся 23 или 25 часов)
+class WindowAggregator {
+public:
+    using WindowFn = std::function<void(const WindowStats&)>;
+
+    WindowAggregator(time_t width, time_t slide, time_t lateness, time_t offset, WindowFn onWindow);
+
+    // Смежные окна длиной width по местному времени; width делит сутки (час, сутки)
+    static WindowAggregator localTime(time_t width, time_t lateness, WindowFn onWindow);
+
+    void add(time_t ts, double value);
+    // Двигает время без новых значений: окна закрываются по часам, даже если датчик молчит
+    void advance(time_t now);
+
+    uint64_t late() const { return late_; }
+
+private:
+    struct Pane {
+        time_t start;
+        RunningStats stats;
+    };
+
+    time_t align(time_t ts) const;
+    time_t paneEnd(time_t start) const;    // граница после куска, начатого в start
+    time_t windowStart(time_t end) const;
+    void closeWindows();
+
+    time_t width_;
+    time_t slide_;
+    time_t lateness_;
+    time_t offset_;
+    bool local_ = false;         // offset_ не используется, сдвиг — на момент границы
+    WindowFn onWindow_;
+
+    std::deque<Pane> panes_;     // куски по возрастанию start, без пропусков
+    time_t watermark_ = 0;       // окна с концом <= watermark_ уже можно закрывать
+    time_t nextEnd_ = 0;         // конец следующего окна к закрытию; 0 — значений ещё не было
+    uint64_t late_ = 0;
+};
+
+// Смещение местного времени относительно UTC в секундах (восток — плюс)
+time_t localUtcOffset(time_t now);
+
+#endif // WINDOW_AGG_H